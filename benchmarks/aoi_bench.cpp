@@ -0,0 +1,186 @@
+// Snapshot traffic with and without area-of-interest filtering. N synthetic
+// players walk around a fixed map; every tick each of them is a client that
+// gets a delta snapshot, built the way Server::broadcastSnapshot builds it:
+// SpatialGrid query, updateVisibleSet, then SnapshotCodec::writeDelta over
+// the visible players only. The same deltas are also encoded over everyone,
+// as the server sent them before filtering. Every client is assumed to ack
+// each delta, so each is encoded against the one before.
+//
+// The grid's answer is checked against a brute-force distance test; the
+// bench exits non-zero if they disagree.
+
+#include "Movement.h"
+#include "PlayerState.h"
+#include "SnapshotCodec.h"
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+  const unsigned int MAP_TILES = 128;
+  const float TILE_SIZE = 32.0f;
+  // Server defaults: 4-tile grid cells, 16-tile view radius, 30 Hz.
+  const unsigned int CELL_TILES = 4;
+  const float VIEW_RADIUS = 16.0f * TILE_SIZE;
+  const float DT = 1.0f / 30.0f;
+  const int TICKS = 300;
+  const int PLAYER_COUNTS[] = {10, 100, 1000};
+
+  struct Client {
+    std::vector<int> visible;
+    std::vector<QuantizedState> filteredBaseline;
+    std::vector<QuantizedState> fullBaseline;
+  };
+
+  double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Everyone walks at player speed in a random direction and turns back at
+  // the map's edges, so the visible sets keep changing.
+  void step(std::vector<PlayerState>& players, std::vector<sf::Vector2f>& velocities, float worldSize) {
+    for (std::size_t i = 0; i < players.size(); ++i) {
+      sf::Vector2f& position = players[i].position;
+      sf::Vector2f& velocity = velocities[i];
+      position += velocity * DT;
+      if (position.x < 0.0f || position.x > worldSize) {
+        velocity.x = -velocity.x;
+        position.x = std::min(std::max(position.x, 0.0f), worldSize);
+      }
+      if (position.y < 0.0f || position.y > worldSize) {
+        velocity.y = -velocity.y;
+        position.y = std::min(std::max(position.y, 0.0f), worldSize);
+      }
+    }
+  }
+
+  bool matchesBruteForce(const std::vector<PlayerState>& players, const PlayerState& self, const std::vector<int>& visible) {
+    std::vector<int> expected;
+    for (const auto& other : players) {
+      float dx = other.position.x - self.position.x;
+      float dy = other.position.y - self.position.y;
+      if (dx * dx + dy * dy <= VIEW_RADIUS * VIEW_RADIUS) {
+        expected.push_back(other.id);
+      }
+    }
+    return expected == visible;
+  }
+}
+
+int main() {
+  const float worldSize = MAP_TILES * TILE_SIZE;
+  SnapshotCodec codec(sf::Vector2f(worldSize, worldSize));
+  SpatialGrid grid;
+  grid.reset(MAP_TILES, MAP_TILES, sf::Vector2f(TILE_SIZE, TILE_SIZE), CELL_TILES);
+
+  std::printf("%u x %u tiles, view radius %.0f, %d ticks at %.0f Hz\n", MAP_TILES, MAP_TILES, VIEW_RADIUS / TILE_SIZE,
+              TICKS, 1.0f / DT);
+  std::printf("%8s %10s %14s %14s %8s %12s %12s\n", "players", "visible", "all bytes/tick", "aoi bytes/tick",
+              "saved", "all ms/tick", "aoi ms/tick");
+
+  int failures = 0;
+  for (int count : PLAYER_COUNTS) {
+    std::mt19937 random(static_cast<unsigned int>(count));
+    std::uniform_real_distribution<float> place(0.0f, worldSize);
+    std::uniform_real_distribution<float> heading(0.0f, 6.2831853f);
+
+    // Sorted by id, as the server's quantized states are.
+    std::vector<PlayerState> players;
+    std::vector<sf::Vector2f> velocities;
+    for (int id = 1; id <= count; ++id) {
+      players.push_back({id, sf::Vector2f(place(random), place(random))});
+      float angle = heading(random);
+      velocities.push_back(sf::Vector2f(std::cos(angle), std::sin(angle)) * PLAYER_SPEED);
+    }
+    std::vector<Client> clients(players.size());
+
+    // The first tick sends everyone a full snapshot either way, so it is
+    // left out of the averages.
+    std::size_t fullBytes = 0;
+    std::size_t filteredBytes = 0;
+    std::size_t visibleTotal = 0;
+    double fullTime = 0.0;
+    double filteredTime = 0.0;
+
+    for (sf::Uint32 sequence = 1; sequence <= TICKS; ++sequence) {
+      step(players, velocities, worldSize);
+      bool counted = sequence > 1;
+
+      auto start = std::chrono::steady_clock::now();
+      std::vector<QuantizedState> allStates = codec.quantizeStates(players);
+      for (auto& client : clients) {
+        sf::Packet packet;
+        codec.writeDelta(packet, sequence, sequence - 1, sequence > 1 ? &client.fullBaseline : nullptr, allStates);
+        client.fullBaseline = allStates;
+        if (counted) {
+          fullBytes += packet.getDataSize();
+        }
+      }
+      if (counted) {
+        fullTime += millisecondsSince(start);
+      }
+
+      start = std::chrono::steady_clock::now();
+      grid.clear();
+      for (const auto& player : players) {
+        grid.insert(player.id, player.position);
+      }
+      allStates = codec.quantizeStates(players);
+      for (std::size_t i = 0; i < clients.size(); ++i) {
+        Client& client = clients[i];
+        std::vector<int> visible;
+        std::vector<int> entered;
+        std::vector<int> left;
+        grid.query(players[i].position, VIEW_RADIUS, visible);
+        updateVisibleSet(visible, client.visible, entered, left);
+
+        // Both lists are sorted by id.
+        std::vector<QuantizedState> current;
+        auto id = client.visible.begin();
+        for (const auto& state : allStates) {
+          while (id != client.visible.end() && *id < static_cast<int>(state.id)) {
+            ++id;
+          }
+          if (id != client.visible.end() && *id == static_cast<int>(state.id)) {
+            current.push_back(state);
+          }
+        }
+
+        sf::Packet packet;
+        codec.writeDelta(packet, sequence, sequence - 1, sequence > 1 ? &client.filteredBaseline : nullptr, current);
+        client.filteredBaseline.swap(current);
+        if (counted) {
+          filteredBytes += packet.getDataSize();
+          visibleTotal += client.visible.size();
+        }
+      }
+      if (counted) {
+        filteredTime += millisecondsSince(start);
+      }
+
+      for (std::size_t i = 0; i < clients.size(); ++i) {
+        if (!matchesBruteForce(players, players[i], clients[i].visible)) {
+          ++failures;
+        }
+      }
+    }
+
+    const double ticks = TICKS - 1;
+    double full = fullBytes / ticks;
+    double filtered = filteredBytes / ticks;
+    std::printf("%8d %10.1f %14.0f %14.0f %7.1f%% %12.3f %12.3f\n", count, visibleTotal / ticks / count, full,
+                filtered, 100.0 * (1.0 - filtered / full), fullTime / ticks, filteredTime / ticks);
+  }
+
+  if (failures) {
+    std::printf("FAILED: %d visible sets differ from the brute-force answer\n", failures);
+    return 1;
+  }
+  std::printf("visible sets match a brute-force check\n");
+  return 0;
+}
@@ -0,0 +1,209 @@
+// Times tmx::base64_decode against the decoder it replaced, on a layer-sized
+// string, and checks every block path (scalar, SSSE3, AVX2) decodes to the
+// same bytes. Exits non-zero on any mismatch.
+//
+// Two inputs: one unbroken string, and the same text wrapped across lines
+// the way Tiled indents layer data. The old decoder stopped at the first
+// newline, so on the wrapped input it is expected to differ; that is
+// reported, not treated as a failure.
+//
+// Build with -DCMAKE_BUILD_TYPE=Release; unoptimised intrinsics are slower
+// than the table loop and the timings mean nothing.
+
+#include <tmxlite/FreeFuncs.hpp>
+#include "detail/Base64.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+  const std::size_t LAYER_BYTES = 8 * 1024 * 1024;
+  const int RUNS = 5;
+
+  // The decoder as it was in FreeFuncs.hpp before the lookup table: a
+  // std::function per character and a linear find over the alphabet.
+  std::string oldBase64Decode(std::string const& encoded_string) {
+    static const std::string base64_chars =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+      "abcdefghijklmnopqrstuvwxyz"
+      "0123456789+/";
+
+    std::function<bool(unsigned char)> is_base64 =
+      [](unsigned char c)->bool {
+        return (isalnum(c) || (c == '+') || (c == '/'));
+      };
+
+    auto in_len = encoded_string.size();
+    int i = 0;
+    int j = 0;
+    int in_ = 0;
+    unsigned char char_array_4[4], char_array_3[3];
+    std::string ret;
+
+    while (in_len-- && (encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
+      char_array_4[i++] = encoded_string[in_]; in_++;
+      if (i == 4) {
+        for (i = 0; i < 4; i++) {
+          char_array_4[i] = static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
+        }
+        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+        for (i = 0; (i < 3); i++) {
+          ret += char_array_3[i];
+        }
+        i = 0;
+      }
+    }
+
+    if (i) {
+      for (j = i; j < 4; j++) {
+        char_array_4[j] = 0;
+      }
+
+      for (j = 0; j < 4; j++) {
+        char_array_4[j] = static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+      }
+
+      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+      for (j = 0; (j < i - 1); j++) {
+        ret += char_array_3[j];
+      }
+    }
+
+    return ret;
+  }
+
+  std::string encode(const std::string& bytes) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text;
+    text.reserve((bytes.size() + 2) / 3 * 4);
+
+    std::size_t i = 0;
+    for (; i + 2 < bytes.size(); i += 3) {
+      unsigned int group = static_cast<unsigned char>(bytes[i]) << 16 |
+                           static_cast<unsigned char>(bytes[i + 1]) << 8 |
+                           static_cast<unsigned char>(bytes[i + 2]);
+      text += alphabet[group >> 18];
+      text += alphabet[(group >> 12) & 63];
+      text += alphabet[(group >> 6) & 63];
+      text += alphabet[group & 63];
+    }
+
+    std::size_t left = bytes.size() - i;
+    if (left > 0) {
+      unsigned int group = static_cast<unsigned char>(bytes[i]) << 16;
+      if (left == 2) {
+        group |= static_cast<unsigned char>(bytes[i + 1]) << 8;
+      }
+      text += alphabet[group >> 18];
+      text += alphabet[(group >> 12) & 63];
+      text += left == 2 ? alphabet[(group >> 6) & 63] : '=';
+      text += '=';
+    }
+    return text;
+  }
+
+  // Lines of 76 characters, each indented, as an editor might save them.
+  std::string wrap(const std::string& text) {
+    std::string wrapped = "\n   ";
+    for (std::size_t i = 0; i < text.size(); i += 76) {
+      wrapped.append(text, i, 76);
+      wrapped += "\n   ";
+    }
+    return wrapped;
+  }
+
+  double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  const char* pathName(tmx::detail::Base64Path path) {
+    switch (path) {
+      case tmx::detail::Base64Path::SSSE3: return "ssse3";
+      case tmx::detail::Base64Path::AVX2: return "avx2";
+      default: return "scalar";
+    }
+  }
+}
+
+int main() {
+  std::mt19937 random(1);
+  std::string bytes(LAYER_BYTES, '\0');
+  for (auto& byte : bytes) {
+    byte = static_cast<char>(random());
+  }
+
+  const std::string text = encode(bytes);
+  const std::string wrapped = wrap(text);
+  const double megabytes = text.size() / (1024.0 * 1024.0);
+  std::printf("%.1f MB of base64, %.1f MB wrapped\n", megabytes, wrapped.size() / (1024.0 * 1024.0));
+
+  int failures = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::string oldDecoded = oldBase64Decode(text);
+  double oldTime = millisecondsSince(start);
+  std::printf("%-8s %-8s %9.2f ms %8.1f MB/s %s\n", "old", "clean", oldTime, megabytes / (oldTime / 1000.0),
+              oldDecoded == bytes ? "ok" : "MISMATCH");
+  if (oldDecoded != bytes) {
+    ++failures;
+  }
+  std::size_t oldWrappedSize = oldBase64Decode(wrapped).size();
+  std::printf("%-8s %-8s decodes %zu of %zu bytes (stops at the first newline)\n", "old", "wrapped",
+              oldWrappedSize, bytes.size());
+
+  std::vector<unsigned char> output(tmx::base64_decodedSize(wrapped.size()));
+  const tmx::detail::Base64Path paths[] = {
+    tmx::detail::Base64Path::Scalar, tmx::detail::Base64Path::SSSE3, tmx::detail::Base64Path::AVX2
+  };
+
+  for (const std::string* input : {&text, &wrapped}) {
+    const char* inputName = input == &text ? "clean" : "wrapped";
+    for (auto path : paths) {
+      if (!tmx::detail::base64_hasPath(path)) {
+        std::printf("%-8s %-8s not supported by this CPU\n", pathName(path), inputName);
+        continue;
+      }
+
+      std::size_t size = 0;
+      double best = 0.0;
+      for (int run = 0; run < RUNS; ++run) {
+        start = std::chrono::steady_clock::now();
+        size = tmx::detail::base64_decodeWith(path, input->data(), input->size(), output.data(), output.size());
+        double time = millisecondsSince(start);
+        best = run == 0 ? time : std::min(best, time);
+      }
+
+      // Every path is held to the original bytes, so they also agree with
+      // each other.
+      bool same = size == bytes.size() && std::equal(bytes.begin(), bytes.end(), output.begin(),
+                                                     [](char a, unsigned char b) { return static_cast<unsigned char>(a) == b; });
+      if (!same) {
+        ++failures;
+      }
+      std::printf("%-8s %-8s %9.2f ms %8.1f MB/s %6.1fx %s\n", pathName(path), inputName, best,
+                  megabytes / (best / 1000.0), oldTime / best, same ? "ok" : "MISMATCH");
+    }
+  }
+
+  // What the library itself picks must match too.
+  std::size_t size = tmx::base64_decode(wrapped.data(), wrapped.size(), output.data(), output.size());
+  if (size != bytes.size() || std::string(output.begin(), output.begin() + size) != bytes) {
+    std::printf("base64_decode MISMATCH\n");
+    ++failures;
+  }
+
+  std::printf("%s\n", failures ? "FAILED" : "all paths agree");
+  return failures ? 1 : 0;
+}
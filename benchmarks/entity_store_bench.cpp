@@ -0,0 +1,230 @@
+// Times the per-frame passes over remote players - movement, animation and
+// a broadcast-style walk over IDs and positions - for 10k entities, once
+// through EntityStore's columns and once through an EntityTable of structs
+// laid out like the Player objects it replaced (sprite, texture handles,
+// chat list and all). Both do the same work; only the layout differs.
+// Exits non-zero if the two broadcasts disagree.
+//
+// Run from the build directory, which holds a copy of Data/, and build
+// with -DCMAKE_BUILD_TYPE=Release for timings that mean anything.
+
+#include "EntityStore.h"
+#include "EntityTable.h"
+
+#include <SFML/Network.hpp>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+  const int ENTITIES = 10000;
+  const int FRAMES = 200;
+  const float DT = 1.0f / 60.0f;
+  // Same as EntityStore and Player.
+  const float ANIMATION_SPEED = 0.2f;
+
+  // Player's members before EntityStore, kept here so the old layout can be
+  // timed without a window to draw Player into.
+  struct OldPlayer {
+    struct ChatMessage {
+      std::string message;
+      float displayTime;
+    };
+
+    int id = 0;
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    std::vector<ChatMessage> chatMessages;
+    std::shared_ptr<const sf::Texture> playerTexture;
+    std::shared_ptr<const TextureAtlas> atlas;
+    const std::vector<sf::IntRect>* frames = nullptr;
+    sf::Sprite playerSprite;
+    float frameTime = 0.0f;
+    int currentFrame = 0;
+    float animationSpeed = ANIMATION_SPEED;
+  };
+
+  // Every other player walks right; the rest stand still, so animation
+  // takes both branches.
+  sf::Vector2f positionAt(int index, int frame) {
+    sf::Vector2f start(static_cast<float>(index % 100) * 32.0f, static_cast<float>(index / 100) * 32.0f);
+    return index % 2 ? start + sf::Vector2f(static_cast<float>(frame) * 2.0f, 0.0f) : start;
+  }
+
+  // Order-independent, since the two layouts keep rows in different orders.
+  struct Broadcast {
+    std::size_t bytes = 0;
+    unsigned long long checksum = 0;
+
+    bool operator==(const Broadcast& other) const { return bytes == other.bytes && checksum == other.checksum; }
+  };
+
+  Broadcast broadcast(sf::Packet& packet, int id, const sf::Vector2f& position, Broadcast total) {
+    packet << static_cast<sf::Int32>(id) << position.x << position.y;
+    total.checksum += static_cast<unsigned long long>(id) * 1000003ull +
+                      static_cast<unsigned long long>(position.x) * 1009ull +
+                      static_cast<unsigned long long>(position.y);
+    return total;
+  }
+
+  double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  struct Timings {
+    double movement = 0.0;
+    double animation = 0.0;
+    double broadcast = 0.0;
+    Broadcast last;
+  };
+
+  Timings runStore(const std::vector<int>& ids) {
+    EntityStore store;
+    std::unordered_map<int, sf::Vector2f> sampled;
+    Timings timings;
+    sf::Packet packet;
+
+    for (int frame = 0; frame < FRAMES; ++frame) {
+      sampled.clear();
+      for (int i = 0; i < ENTITIES; ++i) {
+        sampled[ids[i]] = positionAt(i, frame);
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      store.setPositions(sampled, DT);
+      timings.movement += millisecondsSince(start);
+
+      start = std::chrono::steady_clock::now();
+      store.animate(DT);
+      timings.animation += millisecondsSince(start);
+
+      start = std::chrono::steady_clock::now();
+      packet.clear();
+      Broadcast total;
+      const auto& storeIds = store.getIds();
+      const auto& positions = store.getPositions();
+      for (std::size_t row = 0; row < storeIds.size(); ++row) {
+        total = broadcast(packet, storeIds[row], positions[row], total);
+      }
+      total.bytes = packet.getDataSize();
+      timings.broadcast += millisecondsSince(start);
+      timings.last = total;
+    }
+    return timings;
+  }
+
+  // The loops Game ran over its EntityTable<Player> before EntityStore.
+  Timings runOldLayout(const std::vector<int>& ids) {
+    ResourceCache& cache = ResourceCache::shared();
+    auto atlas = cache.getAtlas("Data/Images/Spritesheet.xml");
+    auto texture = cache.getTexture("Data/Images/Spritesheet.png");
+    const std::vector<sf::IntRect>* frames = &atlas->getAnimation("walk");
+
+    EntityTable<OldPlayer> players;
+    std::unordered_map<int, sf::Vector2f> sampled;
+    Timings timings;
+    sf::Packet packet;
+
+    for (int frame = 0; frame < FRAMES; ++frame) {
+      sampled.clear();
+      for (int i = 0; i < ENTITIES; ++i) {
+        sampled[ids[i]] = positionAt(i, frame);
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      for (const auto& [id, position] : sampled) {
+        OldPlayer* existing = players.find(id);
+        if (existing) {
+          existing->velocity = (position - existing->position) / DT;
+          existing->position = position;
+        } else {
+          OldPlayer player;
+          player.id = id;
+          player.position = position;
+          player.playerTexture = texture;
+          player.atlas = atlas;
+          player.frames = frames;
+          player.playerSprite.setTexture(*texture);
+          player.playerSprite.setScale(0.5f, 0.5f);
+          players.assign(id, std::move(player));
+        }
+      }
+      players.eraseIf([&sampled](const OldPlayer& p) { return !sampled.count(p.id); });
+      timings.movement += millisecondsSince(start);
+
+      // Player::update, chat ageing included.
+      start = std::chrono::steady_clock::now();
+      for (auto& p : players) {
+        p.playerSprite.setPosition(p.position);
+        if (p.frames->empty()) {
+          continue;
+        }
+        if (p.velocity.x != 0.0f || p.velocity.y != 0.0f) {
+          p.frameTime += DT;
+          if (p.frameTime >= p.animationSpeed) {
+            p.frameTime = 0.0f;
+            p.currentFrame = (p.currentFrame + 1) % static_cast<int>(p.frames->size());
+            p.playerSprite.setTextureRect((*p.frames)[p.currentFrame]);
+          }
+        } else {
+          p.currentFrame = 0;
+          p.playerSprite.setTextureRect((*p.frames)[0]);
+        }
+        for (auto& message : p.chatMessages) {
+          message.displayTime -= DT;
+        }
+      }
+      timings.animation += millisecondsSince(start);
+
+      start = std::chrono::steady_clock::now();
+      packet.clear();
+      Broadcast total;
+      for (const auto& p : players) {
+        total = broadcast(packet, p.id, p.position, total);
+      }
+      total.bytes = packet.getDataSize();
+      timings.broadcast += millisecondsSince(start);
+      timings.last = total;
+    }
+    return timings;
+  }
+
+  void print(const char* name, const Timings& timings, const Timings* baseline) {
+    const double loops[] = {timings.movement, timings.animation, timings.broadcast};
+    const double baselines[] = {
+      baseline ? baseline->movement : 0.0, baseline ? baseline->animation : 0.0, baseline ? baseline->broadcast : 0.0
+    };
+    const char* loopNames[] = {"movement", "animation", "broadcast"};
+    for (int i = 0; i < 3; ++i) {
+      std::printf("%-12s %-10s %8.3f ms/frame", name, loopNames[i], loops[i] / FRAMES);
+      if (baseline) {
+        std::printf(" %6.1fx", baselines[i] / loops[i]);
+      }
+      std::printf("\n");
+    }
+  }
+}
+
+int main() {
+  // IDs as the server hands them out: EntityTable keys.
+  EntityTable<int> keys;
+  std::vector<int> ids;
+  for (int i = 0; i < ENTITIES; ++i) {
+    ids.push_back(static_cast<int>(keys.insert(i)));
+  }
+
+  std::printf("%d entities, %d frames\n", ENTITIES, FRAMES);
+  Timings old = runOldLayout(ids);
+  Timings store = runStore(ids);
+  print("old layout", old, nullptr);
+  print("EntityStore", store, &old);
+
+  if (!(old.last == store.last)) {
+    std::printf("FAILED: broadcasts differ (%zu bytes vs %zu)\n", old.last.bytes, store.last.bytes);
+    return 1;
+  }
+  std::printf("broadcasts agree (%zu bytes)\n", store.last.bytes);
+  return 0;
+}
@@ -66,69 +66,46 @@ namespace tmx
     //using inline here just to supress unused warnings on gcc
     bool decompress(const char* source, std::vector<unsigned char>& dest, std::size_t inSize, std::size_t expectedSize);
 
-    static inline std::string base64_decode(std::string const& encoded_string)
+    //streaming version of the above: read() fills the given buffer with up to
+    //size bytes of compressed input and returns how many it wrote, 0 at the
+    //end. Each block of inflated output is passed to write(), which can
+    //return false to stop early. Neither side is ever held in full.
+    bool decompress(const std::function<std::size_t(unsigned char*, std::size_t)>& read,
+        const std::function<bool(const unsigned char*, std::size_t)>& write);
+
+    /*!
+    \brief Returns the most bytes base64_decode() can write when decoding
+    sourceSize characters of base64 text.
+    */
+    constexpr std::size_t base64_decodedSize(std::size_t sourceSize)
     {
-        static const std::string base64_chars =
-            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-            "abcdefghijklmnopqrstuvwxyz"
-            "0123456789+/";            
-            
-        std::function<bool(unsigned char)> is_base64 = 
-            [](unsigned char c)->bool
-        {
-            return (isalnum(c) || (c == '+') || (c == '/'));
-        };
-
-        auto in_len = encoded_string.size();
-        int i = 0;
-        int j = 0;
-        int in_ = 0;
-        unsigned char char_array_4[4], char_array_3[3];
-        std::string ret;
-
-        while (in_len-- && (encoded_string[in_] != '=') && is_base64(encoded_string[in_]))
-        {
-            char_array_4[i++] = encoded_string[in_]; in_++;
-            if (i == 4)
-            {
-                for (i = 0; i < 4; i++)
-                {
-                    char_array_4[i] = static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
-                }
-                char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-                char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-                char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-                for (i = 0; (i < 3); i++)
-                {
-                    ret += char_array_3[i];
-                }
-                i = 0;
-            }
-        }
-
-        if (i)
-        {
-            for (j = i; j < 4; j++)
-            {
-                char_array_4[j] = 0;
-            }
-
-            for (j = 0; j < 4; j++)
-            {
-                char_array_4[j] = static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
-            }
+        return ((sourceSize + 3) / 4) * 3;
+    }
 
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-            for (j = 0; (j < i - 1); j++)
-            {
-                ret += char_array_3[j];
-            }
-        }
+    /*!
+    \brief Decodes base64 text directly into a caller supplied buffer.
+    Whitespace within the text is skipped, and decoding stops at the first
+    padding character or any other character outside the base64 alphabet.
+    Characters are looked up in a table, and whole blocks are decoded with
+    AVX2 or SSSE3 when the CPU supports them.
+    \param source Pointer to the encoded text
+    \param sourceSize Number of characters of source to decode
+    \param dest Buffer to receive the decoded bytes
+    \param destSize Size of dest. Use base64_decodedSize() for a buffer
+    large enough for any input of sourceSize characters.
+    \param sourceUsed If not null, receives the number of characters read.
+    When destSize is a multiple of 3 decoding stops on a group boundary, so
+    text longer than dest can hold is decoded a block at a time by calling
+    again from source + *sourceUsed.
+    \returns Number of bytes written to dest, never more than destSize
+    */
+    TMXLITE_EXPORT_API std::size_t base64_decode(const char* source, std::size_t sourceSize, unsigned char* dest, std::size_t destSize, std::size_t* sourceUsed = nullptr);
 
+    static inline std::string base64_decode(std::string const& encoded_string)
+    {
+        std::string ret(base64_decodedSize(encoded_string.size()), '\0');
+        ret.resize(base64_decode(encoded_string.data(), encoded_string.size(),
+            reinterpret_cast<unsigned char*>(&ret[0]), ret.size()));
         return ret;
     }
 
@@ -82,6 +82,8 @@ namespace tmx
         bool hasRepeatY() const { return m_hasRepeatY; }
 
     private:
+        friend class detail::MapCache;
+
         std::string m_workingDir;
         std::string m_filePath;
         Colour m_transparencyColour;
@@ -161,6 +161,8 @@ namespace tmx
         void addProperty(const pugi::xml_node& node) { m_properties.emplace_back(); m_properties.back().parse(node); }
 
     private:
+        friend class detail::MapCache;
+
         std::string m_name;
         std::string m_class;
         float m_opacity;
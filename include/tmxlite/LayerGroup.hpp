@@ -63,6 +63,8 @@ namespace tmx
         const std::vector<Layer::Ptr>& getLayers() const { return m_layers; }
 
     private:
+        friend class detail::MapCache;
+
 
         std::vector<Layer::Ptr> m_layers;
 
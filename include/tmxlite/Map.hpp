@@ -33,6 +33,7 @@ source distribution.
 #include <tmxlite/Types.hpp>
 #include <tmxlite/Object.hpp>
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <map>
@@ -245,7 +246,52 @@ namespace tmx
         */
         Vector2f getParallaxOrigin() const { return m_parallaxOrigin; }
 
+        /*!
+        \brief Writes the loaded map to a binary cache file.
+        The cache holds the map's layers, tile sets, objects and properties
+        in flat arrays, along with a hash of the TMX and TSX files the map
+        was loaded from. Loading it with loadCache() is a matter of mapping
+        the file and copying the arrays out, rather than parsing XML.
+        The file is written in the byte order of the machine writing it.
+        \param path Path of the cache file to write
+        \returns false if the map was not loaded from a file with load(),
+        uses object templates, or the cache file could not be written
+        */
+        bool saveCache(const std::string& path) const;
+
+        /*!
+        \brief Loads a map from a cache file written by saveCache().
+        \param path Path of the cache file
+        \param mapPath Path of the TMX file the cache was made from. If it,
+        or any TSX file it uses, has changed since the cache was written
+        the cache is out of date and is not loaded.
+        \returns true if the map was loaded from the cache. Otherwise the map
+        is left empty and should be loaded with load() instead.
+        */
+        bool loadCache(const std::string& path, const std::string& mapPath);
+
+        /*!
+        \brief Sets how many threads load() uses to decode tile layers.
+        With more than one thread the layer data of every tile layer, CSV or
+        base64 and any compression, is decoded on a pool of threads once the
+        rest of the map has been read. Tile sets, object groups, image layers
+        and object templates are always read on the calling thread. Either
+        way layers appear in getLayers() in the order they appear in the file.
+        \param count Number of threads to use. 1, the default, decodes every
+        layer on the calling thread. 0 uses one per hardware thread.
+        */
+        void setLoadThreadCount(std::uint32_t count) { m_loadThreadCount = count; }
+
+        /*!
+        \brief Returns the number of threads load() uses to decode tile layers
+        \see setLoadThreadCount()
+        */
+        std::uint32_t getLoadThreadCount() const { return m_loadThreadCount; }
+
     private:
+        friend class detail::MapCache;
+        friend class LayerGroup;
+
         Version m_version;
         std::string m_class;
         Orientation m_orientation;
@@ -273,8 +319,23 @@ namespace tmx
         std::unordered_map<std::string, Object> m_templateObjects;
         std::unordered_map<std::string, Tileset> m_templateTilesets;
 
+        //the TMX file and any TSX files load() read, and a hash of their
+        //contents. The hash is 0 until known: loadCache() sets it, saveCache()
+        //works it out if need be
+        std::vector<std::string> m_sourceFiles;
+        std::uint64_t m_sourceHash;
+
+        std::uint32_t m_loadThreadCount;
+        //tile layers waiting to be decoded when m_loadThreadCount isn't 1
+        std::vector<std::function<void()>> m_pendingTileLayers;
+
         bool parseMapNode(const pugi::xml_node&);
 
+        //parses the tile layer now, or queues it for decodePendingTileLayers().
+        //used by LayerGroup too, for tile layers inside groups
+        void parseTileLayer(Layer&, const pugi::xml_node&);
+        void decodePendingTileLayers();
+
         //always returns false so we can return this
         //on load failure
         bool reset();
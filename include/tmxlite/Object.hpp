@@ -196,6 +196,8 @@ namespace tmx
         const std::string& getTilesetName() const { return m_tilesetName; }
 
     private:
+        friend class detail::MapCache;
+
         std::uint32_t m_UID;
         std::string m_name;
         std::string m_class;
@@ -76,6 +76,8 @@ namespace tmx
         const std::vector<Object>& getObjects() const { return m_objects; }
 
     private:
+        friend class detail::MapCache;
+
         Colour m_colour;
         DrawOrder m_drawOrder;
 
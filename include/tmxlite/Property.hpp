@@ -129,6 +129,8 @@ namespace tmx
 
 
     private:
+        friend class detail::MapCache;
+
         union
         {
             bool m_boolValue;
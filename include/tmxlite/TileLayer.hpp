@@ -89,6 +89,8 @@ namespace tmx
         const std::vector<Chunk>& getChunks() const { return m_chunks; }
 
     private:
+        friend class detail::MapCache;
+
         std::vector<Tile> m_tiles;
         std::vector<Chunk> m_chunks;
         std::size_t m_tileCount;
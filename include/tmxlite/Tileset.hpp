@@ -259,6 +259,8 @@ namespace tmx
         const Tile* getTile(std::uint32_t id) const;
 
     private:
+        friend class detail::MapCache;
+
 
         std::string m_workingDir;
 
@@ -35,6 +35,12 @@ source distribution.
 
 namespace tmx
 {
+    namespace detail
+    {
+        //reads and writes the binary map cache, see Map::saveCache()
+        class MapCache;
+    }
+
     /*!
     \brief Two dimensional vector used to store points and positions
     */
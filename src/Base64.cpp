@@ -0,0 +1,334 @@
+/*********************************************************************
+Matt Marchant 2016 - 2023
+http://trederia.blogspot.com
+
+tmxlite - Zlib license.
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+you must not claim that you wrote the original software.
+If you use this software in a product, an acknowledgment
+in the product documentation would be appreciated but
+is not required.
+
+2. Altered source versions must be plainly marked as such,
+and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+source distribution.
+*********************************************************************/
+
+#include <tmxlite/FreeFuncs.hpp>
+#include "detail/Base64.hpp"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TMX_BASE64_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+//MSVC allows any intrinsic in any function
+#define TMX_TARGET(isa)
+#else
+//gcc and clang need each function told which extensions it may use,
+//so the rest of the library still builds for the baseline CPU
+#define TMX_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+    //entries in the decode table which aren't 6 bit values
+    constexpr std::uint8_t Skip = 0x80; //whitespace, ignored
+    constexpr std::uint8_t Stop = 0xff; //padding or anything else ends the data
+
+    constexpr std::array<std::uint8_t, 256> makeDecodeTable()
+    {
+        std::array<std::uint8_t, 256> table = {};
+        for (auto& entry : table)
+        {
+            entry = Stop;
+        }
+
+        const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (std::uint8_t i = 0; i < 64; ++i)
+        {
+            table[static_cast<unsigned char>(alphabet[i])] = i;
+        }
+
+        table[' '] = Skip;
+        table['\t'] = Skip;
+        table['\r'] = Skip;
+        table['\n'] = Skip;
+        return table;
+    }
+
+    constexpr std::array<std::uint8_t, 256> DecodeTable = makeDecodeTable();
+
+    //decodes as many whole blocks as it can, advancing both pointers,
+    //and stops at the first block which isn't entirely base64 characters
+    using BlockDecoder = void(*)(const std::uint8_t*&, const std::uint8_t*, std::uint8_t*&, const std::uint8_t*);
+
+#ifdef TMX_BASE64_X86
+    //Vectorised lookup after Muła and Lemire, "Faster Base64 Encoding and
+    //Decoding using AVX2 Instructions". Each byte's high and low nibble index
+    //two small tables whose entries share a bit only for invalid characters,
+    //the high nibble picks the offset which maps a character to its value,
+    //then multiply-adds pack four 6 bit values into each 3 bytes.
+    TMX_TARGET("ssse3") inline bool decodeBlockSSSE3(const std::uint8_t* src, std::uint8_t* dst)
+    {
+        const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+        const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(input, 4), nibbleMask);
+        const __m128i loNibbles = _mm_and_si128(input, nibbleMask);
+        const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        const __m128i valid = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+        if (_mm_movemask_epi8(valid) != 0xffff)
+        {
+            return false;
+        }
+
+        const __m128i isSlash = _mm_cmpeq_epi8(input, _mm_set1_epi8(0x2f));
+        const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(isSlash, hiNibbles));
+        input = _mm_add_epi8(input, roll);
+
+        const __m128i merged = _mm_maddubs_epi16(input, _mm_set1_epi32(0x01400140));
+        const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        const __m128i output = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        //writes 16 bytes, of which the first 12 are output
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), output);
+        return true;
+    }
+
+    TMX_TARGET("ssse3") void decodeBlocksSSSE3(const std::uint8_t*& src, const std::uint8_t* srcEnd, std::uint8_t*& dst, const std::uint8_t* dstEnd)
+    {
+        while (srcEnd - src >= 16 && dstEnd - dst >= 16
+            && decodeBlockSSSE3(src, dst))
+        {
+            src += 16;
+            dst += 12;
+        }
+    }
+
+    TMX_TARGET("avx2") void decodeBlocksAVX2(const std::uint8_t*& src, const std::uint8_t* srcEnd, std::uint8_t*& dst, const std::uint8_t* dstEnd)
+    {
+        //the same tables repeated in both lanes, as vpshufb looks up per lane
+        const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                               0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                               0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                               0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+        const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                               0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                               0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                               0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                                 0, 0, 0, 0, 0, 0, 0, 0,
+                                                 0, 16, 19, 4, -65, -65, -71, -71,
+                                                 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+        const __m256i slash = _mm256_set1_epi8(0x2f);
+
+        while (srcEnd - src >= 32 && dstEnd - dst >= 32)
+        {
+            __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+            const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), nibbleMask);
+            const __m256i loNibbles = _mm256_and_si256(input, nibbleMask);
+            const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+            const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+            if (!_mm256_testz_si256(lo, hi))
+            {
+                break;
+            }
+
+            const __m256i isSlash = _mm256_cmpeq_epi8(input, slash);
+            const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(isSlash, hiNibbles));
+            input = _mm256_add_epi8(input, roll);
+
+            const __m256i merged = _mm256_maddubs_epi16(input, _mm256_set1_epi32(0x01400140));
+            __m256i output = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+            output = _mm256_shuffle_epi8(output, shuffle);
+            //each lane now holds 12 bytes, close the gap between them
+            output = _mm256_permutevar8x32_epi32(output, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+            //writes 32 bytes, of which the first 24 are output
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), output);
+            src += 32;
+            dst += 24;
+        }
+
+        //whatever is left may still hold a whole 16 byte block
+        decodeBlocksSSSE3(src, srcEnd, dst, dstEnd);
+    }
+
+    struct CPUFeatures final
+    {
+        bool ssse3 = false;
+        bool avx2 = false;
+    };
+
+    CPUFeatures detectCPU()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        const bool ssse3 = (info[2] & (1 << 9)) != 0;
+        //AVX state has to be enabled by the OS as well as present
+        const bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0
+            && (_xgetbv(0) & 0x6) == 0x6;
+
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osAvx)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        const bool ssse3 = __builtin_cpu_supports("ssse3");
+        const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return { ssse3, avx2 };
+    }
+
+    //nullptr for the scalar path, or one this CPU can't run
+    BlockDecoder blockDecoder(tmx::detail::Base64Path path)
+    {
+        static const CPUFeatures cpu = detectCPU();
+        switch (path)
+        {
+        default:
+        case tmx::detail::Base64Path::Scalar:
+            return nullptr;
+        case tmx::detail::Base64Path::SSSE3:
+            return cpu.ssse3 ? decodeBlocksSSSE3 : nullptr;
+        case tmx::detail::Base64Path::AVX2:
+            return cpu.avx2 ? decodeBlocksAVX2 : nullptr;
+        }
+    }
+#else
+    BlockDecoder blockDecoder(tmx::detail::Base64Path)
+    {
+        return nullptr;
+    }
+#endif
+
+    //the table loop, handing whole blocks to decodeBlocks when there is one
+    std::size_t decode(BlockDecoder decodeBlocks, const char* source, std::size_t sourceSize, unsigned char* dest, std::size_t destSize, std::size_t* sourceUsed)
+    {
+        const auto* src = reinterpret_cast<const std::uint8_t*>(source);
+        const auto* srcEnd = src + sourceSize;
+        auto* dst = dest;
+        const auto* dstEnd = dest + destSize;
+
+        std::uint32_t bits = 0;
+        std::size_t count = 0;
+
+        while (src != srcEnd && dst != dstEnd)
+        {
+            //the vector path only starts on a group boundary, and hands back
+            //to the table at whitespace, padding or the last few bytes
+            if (count == 0 && decodeBlocks)
+            {
+                decodeBlocks(src, srcEnd, dst, dstEnd);
+                if (src == srcEnd || dst == dstEnd)
+                {
+                    break;
+                }
+            }
+
+            const auto value = DecodeTable[*src];
+            if (value == Stop)
+            {
+                break;
+            }
+            ++src;
+
+            if (value == Skip)
+            {
+                continue;
+            }
+
+            bits = (bits << 6) | value;
+            if (++count == 4)
+            {
+                const std::uint8_t bytes[3] =
+                {
+                    static_cast<std::uint8_t>(bits >> 16),
+                    static_cast<std::uint8_t>(bits >> 8),
+                    static_cast<std::uint8_t>(bits)
+                };
+                for (auto i = 0u; i < 3 && dst != dstEnd; ++i)
+                {
+                    *dst++ = bytes[i];
+                }
+                bits = 0;
+                count = 0;
+            }
+        }
+
+        //a trailing group of n characters holds n - 1 whole bytes
+        if (count > 1)
+        {
+            bits <<= 6 * (4 - count);
+            const std::uint8_t bytes[2] =
+            {
+                static_cast<std::uint8_t>(bits >> 16),
+                static_cast<std::uint8_t>(bits >> 8)
+            };
+            for (auto i = 0u; i < count - 1 && dst != dstEnd; ++i)
+            {
+                *dst++ = bytes[i];
+            }
+        }
+
+        if (sourceUsed)
+        {
+            *sourceUsed = static_cast<std::size_t>(src - reinterpret_cast<const std::uint8_t*>(source));
+        }
+        return static_cast<std::size_t>(dst - dest);
+    }
+}
+
+std::size_t tmx::base64_decode(const char* source, std::size_t sourceSize, unsigned char* dest, std::size_t destSize, std::size_t* sourceUsed)
+{
+    //the fastest this CPU has
+    static const BlockDecoder decodeBlocks = []()
+    {
+        auto best = blockDecoder(detail::Base64Path::AVX2);
+        return best ? best : blockDecoder(detail::Base64Path::SSSE3);
+    }();
+    return decode(decodeBlocks, source, sourceSize, dest, destSize, sourceUsed);
+}
+
+bool tmx::detail::base64_hasPath(Base64Path path)
+{
+    return path == Base64Path::Scalar || blockDecoder(path) != nullptr;
+}
+
+std::size_t tmx::detail::base64_decodeWith(Base64Path path, const char* source, std::size_t sourceSize, unsigned char* dest, std::size_t destSize, std::size_t* sourceUsed)
+{
+    return decode(blockDecoder(path), source, sourceSize, dest, destSize, sourceUsed);
+}
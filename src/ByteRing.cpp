@@ -0,0 +1,55 @@
+#include "ByteRing.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  const std::size_t INITIAL_CAPACITY = 4096;
+}
+
+void ByteRing::write(const char* data, std::size_t length) {
+  if (length == 0) {
+    return;
+  }
+  if (count + length > buffer.size()) {
+    grow(count + length);
+  }
+
+  std::size_t tail = (head + count) % buffer.size();
+  std::size_t first = std::min(length, buffer.size() - tail);
+  std::memcpy(&buffer[tail], data, first);
+  std::memcpy(&buffer[0], data + first, length - first);
+  count += length;
+}
+
+const char* ByteRing::peek(std::size_t& length) const {
+  length = std::min(count, buffer.size() - head);
+  return count == 0 ? nullptr : &buffer[head];
+}
+
+void ByteRing::consume(std::size_t length) {
+  length = std::min(length, count);
+  count -= length;
+  head = count == 0 ? 0 : (head + length) % buffer.size();
+}
+
+void ByteRing::clear() {
+  head = 0;
+  count = 0;
+}
+
+// Unwraps the queued bytes to the start of the new buffer.
+void ByteRing::grow(std::size_t needed) {
+  std::size_t capacity = std::max(buffer.size(), INITIAL_CAPACITY);
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+
+  std::vector<char> larger(capacity);
+  if (count > 0) {
+    std::size_t first = std::min(count, buffer.size() - head);
+    std::memcpy(&larger[0], &buffer[head], first);
+    std::memcpy(&larger[first], &buffer[0], count - first);
+  }
+  buffer.swap(larger);
+  head = 0;
+}
@@ -0,0 +1,32 @@
+#ifndef BYTE_RING_H
+#define BYTE_RING_H
+
+#include <cstddef>
+#include <vector>
+
+// FIFO of bytes in a circular buffer. Unlike erasing from the front of a
+// vector, consuming what the socket took costs nothing however much is
+// still queued behind it. The buffer doubles when a write does not fit and
+// never shrinks, so a connection settles on the size its traffic needs.
+class ByteRing {
+ public:
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  void write(const char* data, std::size_t length);
+
+  // The longest run of queued bytes that is contiguous in memory, starting
+  // with the oldest. Empty only when the ring is.
+  const char* peek(std::size_t& length) const;
+  void consume(std::size_t length);
+  void clear();
+
+ private:
+  void grow(std::size_t needed);
+
+  std::vector<char> buffer;
+  std::size_t head = 0;
+  std::size_t count = 0;
+};
+
+#endif // BYTE_RING_H
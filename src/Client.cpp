@@ -1,18 +1,41 @@
 #include "Client.h"
+#include "Protocol.h"
 #include <iostream>
-#include <thread>
+#include <algorithm>
+
+namespace {
+  // The network thread wakes at least this often to pick up what the game
+  // thread queued; otherwise it sleeps in the selector.
+  const sf::Time NETWORK_POLL_INTERVAL = sf::milliseconds(10);
+  // How often positions or inputs go to the server.
+  const sf::Time SEND_INTERVAL = sf::milliseconds(100);
+  // Inputs repeated per PACKET_INPUT; at 60 fps this covers half a second
+  // of lost datagrams.
+  const std::size_t MAX_INPUTS_PER_DATAGRAM = 32;
+  // If the server stops acking altogether, forget the oldest inputs rather
+  // than growing without bound.
+  const std::size_t MAX_UNACKED_INPUTS = 256;
+}
 
 // Constructor with message queue reference
 Client::Client(std::list<std::pair<std::string, std::chrono::steady_clock::time_point>>& mq)
   : messageQueue(mq), socket(std::make_unique<sf::TcpSocket>()) {
   socket->setBlocking(false);
+  if (udpSocket.bind(sf::Socket::AnyPort) != sf::Socket::Done) {
+    std::cerr << "Failed to bind UDP socket, staying on TCP" << std::endl;
+  }
+  udpSocket.setBlocking(false);
+}
+
+Client::~Client() {
+  stop();
 }
 
 void Client::connect() {
   socket->setBlocking(true);
   std::cout << "Attempting to connect to server..." << std::endl;
 
-  sf::Socket::Status status = socket->connect("127.0.0.1", 53000);
+  sf::Socket::Status status = socket->connect(serverAddress, SERVER_PORT);
   if (status == sf::Socket::Done) {
     std::cout << "Connected to server\n";
     connected = true;
@@ -21,7 +44,7 @@ void Client::connect() {
     if (socket->receive(idPacket) == sf::Socket::Done) {
       if (idPacket >> localPlayerId) {
         std::cout << "Assigned Player ID: " << localPlayerId << std::endl;
-        localPlayer = std::make_unique<Player>(localPlayerId, sf::Vector2f(100.0f, 100.0f));
+        negotiateProtocol(idPacket);
       } else {
         std::cerr << "Failed to receive player ID from server." << std::endl;
         connected = false;
@@ -37,120 +60,457 @@ void Client::connect() {
   socket->setBlocking(false);
 }
 
-void Client::input() {
-  while (running) {
-    if (connected) {
-      sendPosition();
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+// Servers that understand the compact wire format append their version and
+// world size to the ID packet; answer with ours so they can switch to it.
+void Client::negotiateProtocol(sf::Packet& idPacket) {
+  sf::Uint8 serverVersion;
+  sf::Vector2f worldSize;
+  if (!(idPacket >> serverVersion >> worldSize.x >> worldSize.y)) {
+    protocolVersion = 0;
+    return;
   }
-}
 
-void Client::runThread() {
-  while (running && connected) {
-    receivePositions();
-    receiveChatMessages();
+  protocolVersion = std::min(serverVersion, PROTOCOL_VERSION);
+  codec.setWorldSize(worldSize);
+
+  // Version 3 needs the UDP token; without it stay on 2. Settled before the
+  // hello, so the server is told the version we will actually speak.
+  if (protocolVersion >= 3 && !(idPacket >> udpToken)) {
+    protocolVersion = 2;
   }
+
+  sf::Packet hello;
+  hello << PACKET_HELLO << protocolVersion;
+  sendTcp(hello);
+}
+
+
+// Repeated from every send cycle until the server echoes it, since either
+// datagram may be lost.
+void Client::sendUdpHello() {
+  sf::Packet packet;
+  packet << PACKET_UDP_HELLO << localPlayerId << udpToken;
+  simulator.send(udpSocket, packet, serverAddress, SERVER_PORT);
 }
 
 void Client::run() {
+  if (!connected || running) {
+    return;
+  }
   running = true;
-  std::thread inputThread(&Client::input, this);
-  std::thread clientRunThread(&Client::runThread, this);
-  inputThread.detach(); // Detach the thread since it will run in the background
-  clientRunThread.detach();
+  networkThread = std::thread(&Client::networkLoop, this);
+}
+
+void Client::stop() {
+  running = false;
+  if (networkThread.joinable()) {
+    networkThread.join();
+  }
+}
+
+// Sleeps in the selector until either socket has data, but no longer than
+// NETWORK_POLL_INTERVAL, since the game thread cannot wake it when it queues
+// something to send.
+void Client::networkLoop() {
+  sf::SocketSelector selector;
+  selector.add(*socket);
+  selector.add(udpSocket);
+  sf::Clock sendClock;
+
+  while (running && connected) {
+    if (selector.wait(NETWORK_POLL_INTERVAL)) {
+      if (selector.isReady(*socket)) {
+        receivePackets();
+      }
+      if (selector.isReady(udpSocket)) {
+        receiveDatagrams();
+      }
+    }
+
+    flushTcp();
+    drainOutgoing();
+    if (sendClock.getElapsedTime() >= SEND_INTERVAL) {
+      sendClock.restart();
+      if (protocolVersion >= 3 && !udpReady) {
+        sendUdpHello();
+      }
+      sendPosition();
+    }
+    flushDatagrams();
+  }
+}
+
+void Client::drainOutgoing() {
+  OutgoingMessage message;
+  while (outgoing.pop(message)) {
+    if (message.type == OutgoingMessage::INPUT) {
+      inputsToSend.push_back(message.input);
+      if (inputsToSend.size() > MAX_UNACKED_INPUTS) {
+        inputsToSend.pop_front();
+      }
+    } else if (message.type == OutgoingMessage::POSITION) {
+      reportedPosition = message.position;
+    } else if (message.type == OutgoingMessage::CHAT) {
+      sf::Packet packet;
+      packet << PACKET_CHAT << localPlayerId << message.text;
+      if (udpReady) {
+        reliable.queue(CHANNEL_CHAT, packet);
+      } else {
+        sendTcp(packet);
+      }
+    }
+  }
 }
 
 void Client::sendPosition() {
-  sf::Vector2f playerPosition = localPlayer->getPosition();
+  if (udpReady) {
+    sendInputs();
+    return;
+  }
+
+  // The next report supersedes this one, so don't pile them up behind a
+  // socket that is still busy.
+  if (!tcpBacklog.empty()) {
+    return;
+  }
+
   sf::Packet packet;
+  packet << PACKET_POSITION << localPlayerId << reportedPosition.x << reportedPosition.y;
+  sendTcp(packet);
+}
 
-  packet << localPlayerId << playerPosition.x << playerPosition.y;
+// Every unacknowledged input goes out again each time, so a lost datagram
+// costs nothing as long as a later one arrives; the server skips the ones it
+// already has. Only the newest MAX_INPUTS_PER_DATAGRAM fit, and an idle
+// player with everything acked sends nothing.
+void Client::sendInputs() {
+  if (inputsToSend.empty()) {
+    return;
+  }
 
-  if (socket->send(packet) != sf::Socket::Done) {
-    std::cerr << "Failed to send player position to server" << std::endl;
+  sf::Packet packet;
+  std::size_t count = std::min(inputsToSend.size(), MAX_INPUTS_PER_DATAGRAM);
+  packet << PACKET_INPUT << inputsToSend.back().sequence << static_cast<sf::Uint8>(count);
+  for (auto it = inputsToSend.end() - count; it != inputsToSend.end(); ++it) {
+    packet << it->buttons << it->dt;
   }
+  simulator.send(udpSocket, packet, serverAddress, SERVER_PORT);
 }
 
-void Client::receivePositions() {
+void Client::receivePackets() {
   sf::Packet packet;
-  while (socket->receive(packet) == sf::Socket::Done) {
-    int playerId;
-    sf::Vector2f receivedPosition;
-    if (packet >> playerId >> receivedPosition.x >> receivedPosition.y) {
-      playerPositions[playerId] = receivedPosition; // Update the position
+  sf::Socket::Status status;
+  while ((status = socket->receive(packet)) == sf::Socket::Done) {
+    int packetType;
+    if (!(packet >> packetType)) {
+      continue;
+    }
+
+    if (packetType == PACKET_SNAPSHOT) {
+      int count = 0;
+      packet >> count;
+      for (int i = 0; i < count; ++i) {
+        int playerId;
+        sf::Vector2f receivedPosition;
+        if (!(packet >> playerId >> receivedPosition.x >> receivedPosition.y)) {
+          break;
+        }
+        playerPositions[playerId] = receivedPosition;
+      }
+      publishSnapshot(false);
+    } else if (packetType == PACKET_SNAPSHOT_COMPACT) {
+      std::vector<PlayerState> states;
+      codec.readSnapshot(packet, states);
+      for (const auto& state : states) {
+        playerPositions[state.id] = state.position;
+      }
+      publishSnapshot(false);
+    } else if (packetType == PACKET_SNAPSHOT_DELTA) {
+      applyDeltaSnapshot(packet);
+    } else {
+      handleMessage(packet, packetType);
     }
   }
-}
 
-void Client::update() {
-  if (localPlayer) {
-    localPlayer->handleInput(window);
-    localPlayer->update(0.0f);
+  if (status == sf::Socket::Disconnected || status == sf::Socket::Error) {
+    std::cerr << "Lost connection to server" << std::endl;
+    connected = false;
   }
 }
 
-void Client::render(sf::RenderWindow& window) {
-  if (localPlayer) {
-    localPlayer->draw(window, font);
+// Packets that arrive either over TCP or through the reliable UDP channels.
+void Client::handleMessage(sf::Packet& packet, int packetType) {
+  NetworkEvent event;
+  if (packetType == PACKET_CHAT) {
+    event.type = NetworkEvent::CHAT;
+    if (packet >> event.playerId >> event.text) {
+      publish(std::move(event));
+    }
+  } else if (packetType == PACKET_PLAYER_JOINED || packetType == PACKET_PLAYER_LEFT) {
+    event.type = packetType == PACKET_PLAYER_JOINED ? NetworkEvent::PLAYER_JOINED : NetworkEvent::PLAYER_LEFT;
+    if (packet >> event.playerId) {
+      publish(std::move(event));
+    }
   }
+}
 
-  // Render other players using updated positions
-  for (const auto& player : playerPositions) {
-    int playerId = player.first;
-    sf::Vector2f position = player.second;
+void Client::receiveDatagrams() {
+  sf::Packet packet;
+  sf::IpAddress sender;
+  unsigned short port;
+  while (udpSocket.receive(packet, sender, port) == sf::Socket::Done) {
+    int packetType;
+    if (sender != serverAddress || port != SERVER_PORT || !(packet >> packetType)) {
+      continue;
+    }
 
-    Player* remotePlayer = createOrUpdateRemotePlayer(playerId, position);
-    remotePlayer->draw(window, font);
+    if (packetType == PACKET_UDP_HELLO) {
+      udpReady = true;
+    } else if (packetType == PACKET_SNAPSHOT_DELTA) {
+      applyDeltaSnapshot(packet);
+    } else if (packetType == PACKET_RELIABLE) {
+      std::vector<sf::Packet> delivered;
+      reliable.receive(packet, delivered);
+      for (auto& message : delivered) {
+        int messageType;
+        if (message >> messageType) {
+          handleMessage(message, messageType);
+        }
+      }
+    } else if (packetType == PACKET_RELIABLE_ACK) {
+      reliable.receiveAck(packet);
+    } else if (packetType == PACKET_INPUT_ACK) {
+      NetworkEvent event;
+      event.type = NetworkEvent::INPUT_ACK;
+      if (packet >> event.sequence >> event.position.x >> event.position.y) {
+        while (!inputsToSend.empty() && inputsToSend.front().sequence <= event.sequence) {
+          inputsToSend.pop_front();
+        }
+        publish(std::move(event));
+      }
+    }
   }
 }
 
-void Client::clearReceivedMessages() {
-  playerChatMessages.clear();
+// Acks and (re)sends for the reliable channels, plus anything the simulator
+// is holding back.
+void Client::flushDatagrams() {
+  if (udpReady) {
+    std::vector<sf::Packet> datagrams;
+    reliable.collectOutgoing(networkClock.getElapsedTime(), datagrams);
+    for (auto& datagram : datagrams) {
+      simulator.send(udpSocket, datagram, serverAddress, SERVER_PORT);
+    }
+  }
+  simulator.flush(udpSocket);
 }
 
-void Client::displayChatMessage(int senderId, const std::string& message) {
-  std::string formattedMessage = (senderId == localPlayerId) ? "You: " : "Player " + std::to_string(senderId) + ": ";
-  formattedMessage += message;
+// Rebuilds the full player list from the delta and the baseline it refers
+// to, then acknowledges it so the server diffs against it from now on.
+// Deltas older than the newest one we have arrived out of order and are
+// dropped.
+void Client::applyDeltaSnapshot(sf::Packet& packet) {
+  sf::Uint32 sequence;
+  std::vector<QuantizedState> states;
+  if (!codec.readDelta(packet, receivedSnapshots, sequence, states)) {
+    return;
+  }
+  if (receivedSnapshots.getLatest() && sequence <= receivedSnapshots.getLatestSequence()) {
+    return;
+  }
+  receivedSnapshots.store(sequence, states);
 
-  messageQueue.emplace_back(formattedMessage, std::chrono::steady_clock::now());
+  sf::Packet ack;
+  ack << PACKET_SNAPSHOT_ACK;
+  SnapshotCodec::writeVarint(ack, sequence);
+  sendUnreliable(ack);
+
+  std::unordered_map<int, sf::Vector2f> positions;
+  for (const auto& state : states) {
+    PlayerState player = codec.dequantizeState(state);
+    positions[player.id] = player.position;
+  }
+  playerPositions.swap(positions);
+  publishSnapshot(true);
+}
+
+// Sends every known position, including players that did not move, so a
+// stop shows up as two equal samples rather than as a gap to extrapolate
+// across. Delta snapshots list everyone in view, so after one of those
+// anyone missing has left.
+void Client::publishSnapshot(bool complete) {
+  NetworkEvent event;
+  event.type = NetworkEvent::SNAPSHOT;
+  event.time = networkClock.getElapsedTime();
+  event.complete = complete;
+  event.players.reserve(playerPositions.size());
+  for (const auto& [playerId, position] : playerPositions) {
+    event.players.push_back({playerId, position});
+  }
+  publish(std::move(event));
 }
 
-Player* Client::createOrUpdateRemotePlayer(int playerId, const sf::Vector2f& position) {
-  auto it = std::find_if(players.begin(), players.end(),
-                         [playerId](const Player& p) { return p.getId() == playerId; });
+// A full queue means the game thread has stalled for a long time; dropping
+// is better than blocking the socket reads behind it.
+void Client::publish(NetworkEvent&& event) {
+  if (!incoming.push(std::move(event))) {
+    std::cerr << "Network event queue full, dropping event" << std::endl;
+  }
+}
 
-  if (it != players.end()) {
-    it->setPosition(position);
+// Over UDP once the server knows our endpoint, TCP before that. Only used
+// for packets where a later one supersedes a lost one, like snapshot acks.
+void Client::sendUnreliable(sf::Packet& packet) {
+  if (udpReady) {
+    simulator.send(udpSocket, packet, serverAddress, SERVER_PORT);
   } else {
-    Player newPlayer(playerId, position);
-    players.push_back(newPlayer);
+    sendTcp(packet);
   }
+}
 
-  return &players.back();
+// Packets go out in order: anything new waits behind a backlog. A packet
+// the socket only took part of stays at the front; SFML remembers how much
+// of it went, and the next flush sends the rest.
+void Client::sendTcp(sf::Packet& packet) {
+  tcpBacklog.push_back(packet);
+  flushTcp();
 }
 
-void Client::receiveChatMessages() {
-  sf::Packet packet;
-  while (socket->receive(packet) == sf::Socket::Done) {
-    int packetType;
-    packet >> packetType;
+// Called every pass of the network loop, which wakes at least every
+// NETWORK_POLL_INTERVAL, so a full send buffer is retried then rather than
+// spun on.
+void Client::flushTcp() {
+  while (!tcpBacklog.empty()) {
+    sf::Socket::Status status = socket->send(tcpBacklog.front());
+    if (status == sf::Socket::Partial || status == sf::Socket::NotReady) {
+      return;
+    }
+    if (status != sf::Socket::Done) {
+      std::cerr << "Failed to send packet to server" << std::endl;
+    }
+    tcpBacklog.pop_front();
+  }
+}
 
-    if (packetType == 1) { // Chat message type
-      int senderId;
-      std::string message;
-      if (packet >> senderId >> message) {
-        displayChatMessage(senderId, message);
+void Client::poll() {
+  NetworkEvent event;
+  while (incoming.pop(event)) {
+    switch (event.type) {
+      case NetworkEvent::SNAPSHOT:
+        recordRemotePositions(event);
+        break;
+      case NetworkEvent::CHAT:
+        displayChatMessage(event.playerId, event.text);
+        break;
+      case NetworkEvent::PLAYER_JOINED:
+      case NetworkEvent::PLAYER_LEFT: {
+        std::string change = event.type == NetworkEvent::PLAYER_JOINED ? " joined" : " left";
+        messageQueue.emplace_back("Player " + std::to_string(event.playerId) + change,
+                                  std::chrono::steady_clock::now());
+        break;
       }
+      case NetworkEvent::INPUT_ACK:
+        reconcile(event.sequence, event.position);
+        break;
     }
   }
 }
 
-void Client::sendChatMessage(const std::string& message) {
-  sf::Packet packet;
-  packet << 1 << localPlayerId << message;
+void Client::send(OutgoingMessage&& message) {
+  if (!outgoing.push(std::move(message))) {
+    std::cerr << "Network send queue full, dropping message" << std::endl;
+  }
+}
 
-  if (socket->send(packet) != sf::Socket::Done) {
-    std::cerr << "[Error] Failed to send chat message." << std::endl;
+void Client::recordInput(sf::Uint8 buttons, float dt) {
+  InputCommand input{nextInputSequence++, buttons, dt};
+  unackedInputs.push_back(input);
+  if (unackedInputs.size() > MAX_UNACKED_INPUTS) {
+    unackedInputs.pop_front();
   }
+
+  OutgoingMessage message;
+  message.type = OutgoingMessage::INPUT;
+  message.input = input;
+  send(std::move(message));
 }
+
+void Client::setLocalPosition(const sf::Vector2f& position) {
+  OutgoingMessage message;
+  message.type = OutgoingMessage::POSITION;
+  message.position = position;
+  send(std::move(message));
+}
+
+bool Client::takeCorrection(sf::Vector2f& position) {
+  if (!hasCorrection) {
+    return false;
+  }
+  position = correctedPosition;
+  hasCorrection = false;
+  return true;
+}
+
+// Rewinds to the server's position for `sequence` and replays every input
+// recorded since with the same simulateMovement the server used. Acks that
+// arrive out of order are ignored.
+void Client::reconcile(sf::Uint32 sequence, const sf::Vector2f& serverPosition) {
+  if (sequence <= lastAckedInput) {
+    return;
+  }
+  lastAckedInput = sequence;
+
+  while (!unackedInputs.empty() && unackedInputs.front().sequence <= sequence) {
+    unackedInputs.pop_front();
+  }
+
+  correctedPosition = serverPosition;
+  for (const auto& input : unackedInputs) {
+    correctedPosition = collisionGrid ? simulateMovement(*collisionGrid, correctedPosition, input.buttons, input.dt)
+                                      : stepMovement(correctedPosition, input.buttons, input.dt);
+  }
+  hasCorrection = true;
+}
+
+void Client::recordRemotePositions(const NetworkEvent& snapshot) {
+  for (const auto& player : snapshot.players) {
+    remoteHistory[player.id].push(snapshot.time, player.position);
+  }
+
+  if (snapshot.complete) {
+    for (auto it = remoteHistory.begin(); it != remoteHistory.end();) {
+      bool listed = std::any_of(snapshot.players.begin(), snapshot.players.end(),
+                                [&it](const PlayerState& p) { return p.id == it->first; });
+      if (listed) {
+        ++it;
+      } else {
+        it = remoteHistory.erase(it);
+      }
+    }
+  }
+}
+
+void Client::sampleRemotePlayers(std::unordered_map<int, sf::Vector2f>& positions) {
+  sf::Time renderTime = networkClock.getElapsedTime() - interpolationDelay;
+
+  positions.clear();
+  for (const auto& [playerId, history] : remoteHistory) {
+    if (playerId != localPlayerId) {
+      positions[playerId] = history.sample(renderTime, maxExtrapolation);
+    }
+  }
+}
+
+void Client::displayChatMessage(int senderId, const std::string& message) {
+  std::string formattedMessage = (senderId == localPlayerId) ? "You: " : "Player " + std::to_string(senderId) + ": ";
+  formattedMessage += message;
+
+  messageQueue.emplace_back(formattedMessage, std::chrono::steady_clock::now());
+}
+
+void Client::sendChatMessage(const std::string& message) {
+  OutgoingMessage outgoingMessage;
+  outgoingMessage.type = OutgoingMessage::CHAT;
+  outgoingMessage.text = message;
+  send(std::move(outgoingMessage));
+}
\ No newline at end of file
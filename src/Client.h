@@ -4,71 +4,156 @@
 #include <SFML/Network.hpp>
 #include <memory>
 #include <vector>
-#include "Player.h" // Include Player header
+#include "Movement.h"
+#include "SnapshotCodec.h"
+#include "SnapshotHistory.h"
 #include <unordered_map>
-#include <queue>
 #include <list>
 #include <string>
 #include <utility>
 #include <chrono>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include "CollisionGrid.h"
+#include "InterpolationBuffer.h"
+#include "NetworkSimulator.h"
+#include "PlayerState.h"
+#include "ReliableEndpoint.h"
+#include "SpscQueue.h"
 
 
+// Talks to the server from one network thread. That thread blocks on both
+// sockets, decodes whatever arrives and hands the results to the game thread
+// as NetworkEvents through a lock-free queue; the game thread sends the
+// other way through a second queue. Neither thread touches the other's
+// state, so nothing here needs a lock: sockets, codec and reliability state
+// belong to the network thread, and prediction, interpolation and the chat
+// message queue to the game thread, which calls poll() once per frame.
 class Client {
   std::list<std::pair<std::string, std::chrono::steady_clock::time_point>>& messageQueue;
  public:
-  sf::Font font;
-
   Client(std::list<std::pair<std::string, std::chrono::steady_clock::time_point>>& mq);
-  std::unique_ptr<Player>& getLocalPlayer() { return localPlayer; }
-  bool windowFocused = true;
+  ~Client();
+  int getLocalPlayerId() const { return localPlayerId; }
   void connect();
-  void addMessageToRenderQueue(const std::string& message);
-  sf::TcpSocket& getClientSocket();
-  std::queue<std::string> renderQueue;
-  void input();
-  void runThread();
+  void negotiateProtocol(sf::Packet& idPacket);
+  // Starts the network thread once connected; stop() joins it.
   void run();
-  void sendPosition();
-  void receivePositions();
-  void update();
-  void receiveChatMessages();
+  void stop();
+  // Game thread: applies everything the network thread has decoded since
+  // the last call.
+  void poll();
 
-  Player* createOrUpdateRemotePlayer(int playerId, const sf::Vector2f& position);
+  // Client-side prediction, once inputs go over UDP. The game applies each
+  // frame's input locally and records it here; when the server acks an
+  // input, the acked position plus the still-unacked inputs give the
+  // corrected local position, which the game picks up next frame.
+  bool isPredicting() const { return udpReady; }
+  void recordInput(sf::Uint8 buttons, float dt);
+  bool takeCorrection(sf::Vector2f& position);
+  // Map used to replay inputs during reconciliation, as the server does.
+  void setCollisionGrid(const CollisionGrid* grid) { collisionGrid = grid; }
+  // Position reported to servers that do not take inputs.
+  void setLocalPosition(const sf::Vector2f& position);
+  void sendChatMessage(const std::string& message);
+  // Remote players as of `interpolationDelay` ago, interpolated between the
+  // snapshots either side of that time. Positions arrive every ~100 ms, so
+  // the delay needs to cover more than one interval for there to be a pair.
+  void sampleRemotePlayers(std::unordered_map<int, sf::Vector2f>& positions);
+  void setInterpolationDelay(sf::Time delay) { interpolationDelay = delay; }
+  void setMaxExtrapolation(sf::Time limit) { maxExtrapolation = limit; }
+  void displayChatMessage(int senderId, const std::string& message);
 
-  void render(sf::RenderWindow& window);
-  const std::vector<Player>& getPlayers() const;
+ private:
+  // Network thread -> game thread.
+  struct NetworkEvent {
+    enum Type { SNAPSHOT, CHAT, PLAYER_JOINED, PLAYER_LEFT, INPUT_ACK };
+    Type type = SNAPSHOT;
+    int playerId = 0;
+    // SNAPSHOT: every known remote position, when they arrived, and whether
+    // the list is complete (anyone missing has left).
+    std::vector<PlayerState> players;
+    sf::Time time;
+    bool complete = false;
+    // INPUT_ACK
+    sf::Uint32 sequence = 0;
+    sf::Vector2f position;
+    // CHAT
+    std::string text;
+  };
 
+  // Game thread -> network thread.
+  struct OutgoingMessage {
+    enum Type { INPUT, POSITION, CHAT };
+    Type type = INPUT;
+    InputCommand input{0, 0, 0.0f};
+    sf::Vector2f position;
+    std::string text;
+  };
 
-  std::string currentTextInput;
-  void sendChatMessage(const std::string& message);
-  void networkActivity();
-  sf::RenderWindow window;
-  const std::unordered_map<int, sf::Vector2f>& getPlayerPositions() const { return playerPositions; }
-  const std::unordered_map<int, std::vector<std::string>>& getPlayerChatMessages() const {
-    return playerChatMessages;
-  }
-  void clearReceivedMessages();
-  void displayChatMessage(int senderId, const std::string& message);
-  void updatePlayerPosition(int playerId, sf::Vector2f position);
-  void attemptReconnect();
-  bool connectToServer();
+  static const std::size_t QUEUE_CAPACITY = 1024;
 
-  void sendPlayerPosition(const sf::Vector2f& position);
-  std::vector<Player> receiveUpdates();
-  void sendUpdate();
+  // Network thread.
+  void networkLoop();
+  void sendUdpHello();
+  void sendPosition();
+  void sendInputs();
+  void receivePackets();
+  void receiveDatagrams();
+  void handleMessage(sf::Packet& packet, int packetType);
+  void applyDeltaSnapshot(sf::Packet& packet);
+  void publishSnapshot(bool complete);
+  void publish(NetworkEvent&& event);
+  void sendUnreliable(sf::Packet& packet);
+  void sendTcp(sf::Packet& packet);
+  void flushTcp();
+  void drainOutgoing();
+  void flushDatagrams();
 
- private:
+  // Game thread.
+  void send(OutgoingMessage&& message);
+  void reconcile(sf::Uint32 sequence, const sf::Vector2f& serverPosition);
+  void recordRemotePositions(const NetworkEvent& snapshot);
+
+  SpscQueue<NetworkEvent, QUEUE_CAPACITY> incoming;
+  SpscQueue<OutgoingMessage, QUEUE_CAPACITY> outgoing;
+  std::thread networkThread;
+  std::atomic<bool> running{false};
+  std::atomic<bool> udpReady{false};
+  sf::Clock networkClock;
+
+  // Owned by the network thread once it is running.
   std::unique_ptr<sf::TcpSocket> socket;
-  bool running;
-  bool connected;
-  int localPlayerId;
-  std::unique_ptr<Player> localPlayer;
-  bool isServer;
-  std::vector<Client> clients;
-  std::unique_ptr<Client> client;
-  std::vector<Player> players;
+  // TCP packets the socket has not taken yet; the front one may be partly sent.
+  std::deque<sf::Packet> tcpBacklog;
+  // Movement and snapshots, once the server has confirmed our endpoint.
+  sf::UdpSocket udpSocket;
+  sf::IpAddress serverAddress = "127.0.0.1";
+  sf::Uint32 udpToken = 0;
+  // Inputs the server has not acknowledged, resent with every PACKET_INPUT.
+  std::deque<InputCommand> inputsToSend;
+  sf::Vector2f reportedPosition{100.0f, 100.0f};
+  // Chat and join/leave notices once UDP is up.
+  ReliableEndpoint reliable;
+  NetworkSimulator simulator;
+  bool connected = false;
+  int localPlayerId = 0;
+  sf::Uint8 protocolVersion = 0;
+  SnapshotCodec codec;
+  SnapshotHistory receivedSnapshots;
   std::unordered_map<int, sf::Vector2f> playerPositions;
-  std::unordered_map<int, std::vector<std::string>> playerChatMessages;
+
+  // Owned by the game thread.
+  std::deque<InputCommand> unackedInputs;
+  sf::Uint32 nextInputSequence = 1;
+  sf::Uint32 lastAckedInput = 0;
+  sf::Vector2f correctedPosition;
+  bool hasCorrection = false;
+  const CollisionGrid* collisionGrid = nullptr;
+  std::unordered_map<int, InterpolationBuffer> remoteHistory;
+  sf::Time interpolationDelay = sf::milliseconds(200);
+  sf::Time maxExtrapolation = sf::milliseconds(100);
 };
 
 #endif // CLIENT_H
\ No newline at end of file
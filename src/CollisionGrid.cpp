@@ -0,0 +1,89 @@
+#include "CollisionGrid.h"
+#include <tmxlite/TileLayer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+namespace {
+  const std::uint32_t LEGACY_BLOCKING_TILE_ID = 2;
+
+  std::unordered_set<std::uint32_t> findSolidTiles(const tmx::Map& map) {
+    std::unordered_set<std::uint32_t> solid;
+    bool propertyFound = false;
+
+    for (const auto& tileset : map.getTilesets()) {
+      for (const auto& tile : tileset.getTiles()) {
+        for (const auto& property : tile.properties) {
+          if (property.getName() == "solid" && property.getType() == tmx::Property::Type::Boolean) {
+            propertyFound = true;
+            if (property.getBoolValue()) {
+              solid.insert(tileset.getFirstGID() + tile.ID);
+            }
+          }
+        }
+      }
+    }
+
+    if (!propertyFound) {
+      solid.insert(LEGACY_BLOCKING_TILE_ID);
+    }
+    return solid;
+  }
+}
+
+bool CollisionGrid::build(const tmx::Map& map, float scale) {
+  columns = map.getTileCount().x;
+  rows = map.getTileCount().y;
+  cellSize = sf::Vector2f(map.getTileSize().x * scale, map.getTileSize().y * scale);
+  cells.assign(static_cast<std::size_t>(columns) * rows, 0);
+
+  if (cells.empty() || cellSize.x <= 0.0f || cellSize.y <= 0.0f) {
+    return false;
+  }
+
+  const auto solidTiles = findSolidTiles(map);
+
+  for (const auto& layer : map.getLayers()) {
+    if (layer->getType() != tmx::Layer::Type::Tile) {
+      continue;
+    }
+
+    const auto& tiles = layer->getLayerAs<tmx::TileLayer>().getTiles();
+    for (std::size_t i = 0; i < tiles.size() && i < cells.size(); ++i) {
+      if (solidTiles.count(tiles[i].ID)) {
+        cells[i] = 1;
+      }
+    }
+  }
+  return true;
+}
+
+bool CollisionGrid::isBlocked(int column, int row) const {
+  if (column < 0 || row < 0 || column >= static_cast<int>(columns) || row >= static_cast<int>(rows)) {
+    return false;
+  }
+  return cells[row * columns + column] != 0;
+}
+
+bool CollisionGrid::findOverlap(const sf::Vector2f& position, const sf::Vector2f& size, sf::Vector2f& cellPosition) const {
+  if (cells.empty()) {
+    return false;
+  }
+
+  // Half-open cell range covered by the box; a box that only touches a cell
+  // edge does not overlap it.
+  int firstColumn = std::max(0, static_cast<int>(std::floor(position.x / cellSize.x)));
+  int firstRow = std::max(0, static_cast<int>(std::floor(position.y / cellSize.y)));
+  int lastColumn = std::min(static_cast<int>(columns), static_cast<int>(std::ceil((position.x + size.x) / cellSize.x)));
+  int lastRow = std::min(static_cast<int>(rows), static_cast<int>(std::ceil((position.y + size.y) / cellSize.y)));
+
+  for (int row = firstRow; row < lastRow; ++row) {
+    for (int column = firstColumn; column < lastColumn; ++column) {
+      if (cells[row * columns + column]) {
+        cellPosition = sf::Vector2f(column * cellSize.x, row * cellSize.y);
+        return true;
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,38 @@
+#ifndef COLLISION_GRID_H
+#define COLLISION_GRID_H
+
+#include <SFML/System/Vector2.hpp>
+#include <tmxlite/Map.hpp>
+#include <cstdint>
+#include <vector>
+
+// One byte per map cell, non-zero where any tile layer has a blocking tile.
+// Built once when the map loads; a query only visits the cells under the
+// box being tested, so its cost does not grow with the size of the map.
+//
+// A tile blocks if its tileset gives it a boolean "solid" property set to
+// true. Maps whose tilesets define no such property fall back to treating
+// tile ID 2 as the wall tile.
+class CollisionGrid {
+ public:
+  bool build(const tmx::Map& map, float scale);
+
+  unsigned int getColumns() const { return columns; }
+  unsigned int getRows() const { return rows; }
+  // Size of one cell in world units (map tile size times the map scale).
+  sf::Vector2f getCellSize() const { return cellSize; }
+
+  bool isBlocked(int column, int row) const;
+
+  // Looks for a blocking cell overlapping the box at `position` with `size`.
+  // On a hit, writes the cell's top-left world position and returns true.
+  bool findOverlap(const sf::Vector2f& position, const sf::Vector2f& size, sf::Vector2f& cellPosition) const;
+
+ private:
+  unsigned int columns = 0;
+  unsigned int rows = 0;
+  sf::Vector2f cellSize;
+  std::vector<std::uint8_t> cells;
+};
+
+#endif // COLLISION_GRID_H
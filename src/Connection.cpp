@@ -0,0 +1,132 @@
+#include "Connection.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+  const std::size_t HEADER_SIZE = 4;
+  const std::size_t READ_CHUNK = 4096;
+  // Anything bigger than this is not a packet we ever send, so treat it as a
+  // corrupt stream rather than trying to buffer it.
+  const std::size_t MAX_PACKET_SIZE = 64 * 1024;
+  // Outbound backlog limits; see Connection.h.
+  const std::size_t CONGESTED_BYTES = 16 * 1024;
+  const std::size_t MAX_PENDING_BYTES = 256 * 1024;
+  // Simulated time a client can bank: enough to cover input commands that
+  // arrive in a burst after network jitter, not enough to speed-hack with.
+  const float MAX_INPUT_BACKLOG = 0.5f;
+}
+
+Connection::Connection(std::unique_ptr<sf::TcpSocket> s)
+  : socket(std::move(s)), playerId(0), protocolVersion(0), bytesQueued(0), inputTimeBudget(MAX_INPUT_BACKLOG), open(true) {
+  socket->setBlocking(false);
+}
+
+float Connection::takeInputTime(float dt, sf::Time now) {
+  if (inputClockStarted) {
+    inputTimeBudget = std::min(inputTimeBudget + (now - lastInputTime).asSeconds(), MAX_INPUT_BACKLOG);
+  }
+  inputClockStarted = true;
+  lastInputTime = now;
+
+  float granted = std::min(std::max(dt, 0.0f), inputTimeBudget);
+  inputTimeBudget -= granted;
+  return granted;
+}
+
+bool Connection::receive(std::vector<sf::Packet>& packets) {
+  char chunk[READ_CHUNK];
+  std::size_t received = 0;
+  sf::Socket::Status status = socket->receive(chunk, sizeof(chunk), received);
+
+  if (status == sf::Socket::Disconnected || status == sf::Socket::Error) {
+    close();
+    return false;
+  }
+  readBuffer.insert(readBuffer.end(), chunk, chunk + received);
+
+  std::size_t offset = 0;
+  while (readBuffer.size() - offset >= HEADER_SIZE) {
+    const unsigned char* header = reinterpret_cast<const unsigned char*>(&readBuffer[offset]);
+    std::size_t size = (static_cast<std::size_t>(header[0]) << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+
+    if (size > MAX_PACKET_SIZE) {
+      std::cerr << "Dropping client that sent an oversized packet (" << size << " bytes)." << std::endl;
+      close();
+      return false;
+    }
+    if (readBuffer.size() - offset - HEADER_SIZE < size) {
+      break;
+    }
+
+    sf::Packet packet;
+    packet.append(&readBuffer[offset + HEADER_SIZE], size);
+    packets.push_back(packet);
+    offset += HEADER_SIZE + size;
+  }
+  readBuffer.erase(readBuffer.begin(), readBuffer.begin() + offset);
+
+  return true;
+}
+
+void Connection::queuePacket(const sf::Packet& packet) {
+  if (!open) {
+    return;
+  }
+
+  std::size_t size = packet.getDataSize();
+  const char header[HEADER_SIZE] = {
+    static_cast<char>((size >> 24) & 0xff),
+    static_cast<char>((size >> 16) & 0xff),
+    static_cast<char>((size >> 8) & 0xff),
+    static_cast<char>(size & 0xff)
+  };
+  const char* data = static_cast<const char*>(packet.getData());
+
+  if (writeBuffer.size() + HEADER_SIZE + size > MAX_PENDING_BYTES) {
+    std::cerr << "Dropping client " << playerId << ": " << writeBuffer.size()
+              << " bytes still unsent." << std::endl;
+    close();
+    return;
+  }
+
+  writeBuffer.write(header, HEADER_SIZE);
+  writeBuffer.write(data, size);
+  bytesQueued += HEADER_SIZE + size;
+}
+
+bool Connection::isCongested() const {
+  return writeBuffer.size() > CONGESTED_BYTES;
+}
+
+void Connection::flush() {
+  if (!open || writeBuffer.empty()) {
+    return;
+  }
+
+  // At most two sends: the ring's contiguous run, then the part that wrapped
+  // round to the start, if the socket took all of the first.
+  while (!writeBuffer.empty()) {
+    std::size_t length = 0;
+    const char* data = writeBuffer.peek(length);
+    std::size_t sent = 0;
+    sf::Socket::Status status = socket->send(data, length, sent);
+
+    if (status == sf::Socket::Disconnected || status == sf::Socket::Error) {
+      std::cerr << "Failed to send to client at address: " << socket->getRemoteAddress() << std::endl;
+      close();
+      return;
+    }
+    writeBuffer.consume(sent);
+    if (status != sf::Socket::Done || sent < length) {
+      return;
+    }
+  }
+}
+
+void Connection::close() {
+  if (open) {
+    socket->disconnect();
+    open = false;
+  }
+  writeBuffer.clear();
+}
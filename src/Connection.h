@@ -0,0 +1,94 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <SFML/Network.hpp>
+#include <memory>
+#include <vector>
+#include "ByteRing.h"
+#include "ReliableEndpoint.h"
+#include "SnapshotHistory.h"
+
+// One client connection owned by the server event loop. Incoming bytes are
+// buffered until a whole SFML packet (4-byte big-endian size + payload) is
+// available, and outgoing packets are framed into a ring buffer that is
+// flushed without blocking whenever the loop gets round to it, so however
+// many packets queued up since the last flush go out in one send.
+//
+// A client that cannot keep up is throttled and then dropped: past
+// CONGESTED_BYTES of backlog isCongested() tells the server to skip
+// snapshots it can resend later, and a packet that would take the backlog
+// past MAX_PENDING_BYTES closes the connection.
+class Connection {
+ public:
+  explicit Connection(std::unique_ptr<sf::TcpSocket> socket);
+
+  sf::TcpSocket& getSocket() { return *socket; }
+  int getPlayerId() const { return playerId; }
+  void setPlayerId(int id) { playerId = id; }
+  // Wire format agreed with the client; 0 until it sends PACKET_HELLO.
+  sf::Uint8 getProtocolVersion() const { return protocolVersion; }
+  void setProtocolVersion(sf::Uint8 version) { protocolVersion = version; }
+  // Delta snapshots sent to this client and the one it acknowledged last.
+  SnapshotHistory& getSnapshotHistory() { return snapshotHistory; }
+  // Sorted ids of the players inside this client's area of interest as of
+  // the last snapshot.
+  std::vector<int>& getVisiblePlayers() { return visiblePlayers; }
+  std::size_t getBytesQueued() const { return bytesQueued; }
+
+  // The UDP side of this client, once it has proven it owns `udpToken`.
+  sf::Uint32 getUdpToken() const { return udpToken; }
+  void setUdpToken(sf::Uint32 token) { udpToken = token; }
+  bool hasUdpEndpoint() const { return udpPort != 0; }
+  const sf::IpAddress& getUdpAddress() const { return udpAddress; }
+  unsigned short getUdpPort() const { return udpPort; }
+  void setUdpEndpoint(const sf::IpAddress& address, unsigned short port) {
+    udpAddress = address;
+    udpPort = port;
+  }
+  // Chat and join/leave notices to and from the UDP endpoint.
+  ReliableEndpoint& getReliable() { return reliable; }
+  // Newest input command queued for simulation; commands at or below it
+  // are stale and dropped. Also whether the client still needs an ack.
+  sf::Uint32 getLastInputSequence() const { return lastInputSequence; }
+  void setLastInputSequence(sf::Uint32 sequence) { lastInputSequence = sequence; }
+  bool isInputAckPending() const { return inputAckPending; }
+  void setInputAckPending(bool pending) { inputAckPending = pending; }
+  // Grants as much of `dt` as the client has earned: real time passes at
+  // the same rate for everyone, so its commands may not add up to more
+  // than the time since it connected, give or take MAX_INPUT_BACKLOG.
+  // `now` is the server's clock.
+  float takeInputTime(float dt, sf::Time now);
+
+  bool isOpen() const { return open; }
+  bool hasPendingWrites() const { return !writeBuffer.empty(); }
+  bool isCongested() const;
+
+  // Reads whatever the socket has ready and appends every complete packet to
+  // `packets`. Returns false once the peer has gone away.
+  bool receive(std::vector<sf::Packet>& packets);
+  void queuePacket(const sf::Packet& packet);
+  void flush();
+  void close();
+
+ private:
+  std::unique_ptr<sf::TcpSocket> socket;
+  std::vector<char> readBuffer;
+  ByteRing writeBuffer;
+  int playerId;
+  sf::Uint8 protocolVersion;
+  SnapshotHistory snapshotHistory;
+  std::vector<int> visiblePlayers;
+  std::size_t bytesQueued;
+  sf::Uint32 udpToken = 0;
+  sf::IpAddress udpAddress;
+  unsigned short udpPort = 0;
+  sf::Uint32 lastInputSequence = 0;
+  bool inputAckPending = false;
+  float inputTimeBudget;
+  sf::Time lastInputTime;
+  bool inputClockStarted = false;
+  ReliableEndpoint reliable;
+  bool open;
+};
+
+#endif // CONNECTION_H
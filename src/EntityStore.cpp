@@ -0,0 +1,134 @@
+#include "EntityStore.h"
+
+namespace {
+  // Matches Player: the same sheet, scale and frame rate.
+  const float SPRITE_SCALE = 0.5f;
+  const float ANIMATION_SPEED = 0.2f;
+}
+
+EntityStore::EntityStore() : renderAlpha(1.0f), vertices(sf::Quads) {
+  ResourceCache& cache = ResourceCache::shared();
+  atlas = cache.getAtlas("Data/Images/Spritesheet.xml");
+  texture = cache.getTexture("Data/Images/Spritesheet.png");
+  frames = &atlas->getAnimation("walk");
+}
+
+void EntityStore::setPositions(const std::unordered_map<int, sf::Vector2f>& sampled, float dt) {
+  previousPositions = positions;
+
+  // Players who left go first, so an ID the server has reused for someone
+  // new never meets the old player's row.
+  stale.clear();
+  for (int id : ids) {
+    if (!sampled.count(id)) {
+      stale.push_back(id);
+    }
+  }
+  for (int id : stale) {
+    remove(id);
+  }
+
+  for (const auto& [id, position] : sampled) {
+    setPosition(id, position, dt);
+  }
+}
+
+void EntityStore::setPosition(int id, const sf::Vector2f& position, float dt) {
+  auto found = rows.find(id);
+  if (found == rows.end()) {
+    addRow(id, position);
+    return;
+  }
+
+  std::size_t row = found->second;
+  sf::Vector2f& current = positions[row];
+  velocities[row] = dt > 0.0f ? (position - current) / dt : sf::Vector2f();
+  current = position;
+}
+
+std::size_t EntityStore::addRow(int id, const sf::Vector2f& position) {
+  std::size_t row = ids.size();
+  ids.push_back(id);
+  positions.push_back(position);
+  previousPositions.push_back(position);
+  velocities.push_back(sf::Vector2f());
+  animations.push_back(Animation());
+  rows[id] = row;
+  return row;
+}
+
+bool EntityStore::remove(int id) {
+  auto found = rows.find(id);
+  if (found == rows.end()) {
+    return false;
+  }
+
+  std::size_t row = found->second;
+  rows.erase(found);
+  std::size_t last = ids.size() - 1;
+  if (row != last) {
+    ids[row] = ids[last];
+    positions[row] = positions[last];
+    previousPositions[row] = previousPositions[last];
+    velocities[row] = velocities[last];
+    animations[row] = animations[last];
+    rows[ids[row]] = row;
+  }
+  ids.pop_back();
+  positions.pop_back();
+  previousPositions.pop_back();
+  velocities.pop_back();
+  animations.pop_back();
+  return true;
+}
+
+void EntityStore::animate(float dt) {
+  if (frames->empty()) {
+    return;
+  }
+
+  unsigned int frameCount = static_cast<unsigned int>(frames->size());
+  for (std::size_t i = 0; i < animations.size(); ++i) {
+    Animation& animation = animations[i];
+    if (velocities[i].x == 0.0f && velocities[i].y == 0.0f) {
+      animation.frame = 0;
+      continue;
+    }
+
+    animation.frameTime += dt;
+    if (animation.frameTime >= ANIMATION_SPEED) {
+      animation.frameTime = 0.0f;
+      animation.frame = (animation.frame + 1) % frameCount;
+    }
+  }
+}
+
+void EntityStore::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+  if (ids.empty() || frames->empty()) {
+    return;
+  }
+
+  vertices.resize(ids.size() * 4);
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    const sf::IntRect& rect = (*frames)[animations[i].frame];
+    float left = static_cast<float>(rect.left);
+    float top = static_cast<float>(rect.top);
+    float width = static_cast<float>(rect.width);
+    float height = static_cast<float>(rect.height);
+    sf::Vector2f size(width * SPRITE_SCALE, height * SPRITE_SCALE);
+    sf::Vector2f position = previousPositions[i] + (positions[i] - previousPositions[i]) * renderAlpha;
+
+    sf::Vertex* quad = &vertices[i * 4];
+    quad[0].position = position;
+    quad[1].position = sf::Vector2f(position.x + size.x, position.y);
+    quad[2].position = position + size;
+    quad[3].position = sf::Vector2f(position.x, position.y + size.y);
+    quad[0].texCoords = sf::Vector2f(left, top);
+    quad[1].texCoords = sf::Vector2f(left + width, top);
+    quad[2].texCoords = sf::Vector2f(left + width, top + height);
+    quad[3].texCoords = sf::Vector2f(left, top + height);
+  }
+
+  states.texture = texture.get();
+  target.draw(vertices, states);
+}
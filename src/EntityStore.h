@@ -0,0 +1,73 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "ResourceCache.h"
+
+// The remote players the game draws, stored column by column: IDs,
+// positions, velocities and animation state each sit in their own packed
+// array, indexed by row. The per-frame passes only read the columns they
+// need - movement touches positions and velocities, animation velocities
+// and animation state, drawing positions and frames - instead of dragging
+// whole Player objects with their sprites and chat bubbles through the
+// cache. Removing a player moves the last row into its place, so the
+// arrays stay packed. Everyone shares one texture and is drawn as a single
+// vertex array, one draw call however many players there are.
+class EntityStore : public sf::Drawable {
+ public:
+  EntityStore();
+
+  std::size_t size() const { return ids.size(); }
+  bool contains(int id) const { return rows.count(id) != 0; }
+
+  // Moves (or adds) each player to its sampled position, taking the velocity
+  // from how far it went in `dt`, and removes everyone not listed. The
+  // positions from before the call are kept for drawing between steps.
+  void setPositions(const std::unordered_map<int, sf::Vector2f>& positions, float dt);
+  void setPosition(int id, const sf::Vector2f& position, float dt);
+  bool remove(int id);
+
+  // Steps walk animations for players that are moving; idle players show
+  // the first frame.
+  void animate(float dt);
+
+  // Draw players this far (0-1) from their previous positions to their
+  // current ones.
+  void setRenderAlpha(float alpha) { renderAlpha = alpha; }
+
+  const std::vector<int>& getIds() const { return ids; }
+  const std::vector<sf::Vector2f>& getPositions() const { return positions; }
+
+ private:
+  struct Animation {
+    float frameTime = 0.0f;
+    unsigned int frame = 0;
+  };
+
+  std::size_t addRow(int id, const sf::Vector2f& position);
+  void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+  // Row of each player ID. Keyed by the whole ID rather than an
+  // EntityTable slot, so a reused slot with a new generation can't alias
+  // the row of the player it replaced.
+  std::unordered_map<int, std::size_t> rows;
+
+  std::vector<int> ids;
+  std::vector<sf::Vector2f> positions;
+  std::vector<sf::Vector2f> previousPositions;
+  std::vector<sf::Vector2f> velocities;
+  std::vector<Animation> animations;
+  // Scratch for setPositions; kept to avoid reallocating every frame.
+  std::vector<int> stale;
+
+  std::shared_ptr<const sf::Texture> texture;
+  std::shared_ptr<const TextureAtlas> atlas;
+  const std::vector<sf::IntRect>* frames;
+  float renderAlpha;
+  mutable sf::VertexArray vertices;
+};
+
+#endif // ENTITY_STORE_H
@@ -0,0 +1,163 @@
+#ifndef ENTITY_TABLE_H
+#define ENTITY_TABLE_H
+
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Generational slot map. Values live packed in one vector, so iterating
+// them is a straight walk through memory; a key finds its value in constant
+// time through a slot that holds the value's dense index.
+//
+// A key is (slot index << 8) | generation. A slot's generation moves on
+// each time its value is erased, so a key kept after its entity is gone
+// (say, an ID in a late packet from a player who has since left, whose slot
+// now holds someone else) is recognised as stale instead of finding the
+// wrong entity. Generations run 1-255, so no valid key is 0.
+//
+// The server hands out keys with insert() and uses them as player IDs. The
+// client mirrors those IDs with assign(), which places a value at whatever
+// key it is given.
+template <typename T>
+class EntityTable {
+ public:
+  typedef sf::Uint32 Key;
+
+  static Key makeKey(sf::Uint32 index, sf::Uint8 generation) { return (index << 8) | generation; }
+  static sf::Uint32 keyIndex(Key key) { return key >> 8; }
+  static sf::Uint8 keyGeneration(Key key) { return static_cast<sf::Uint8>(key & 0xff); }
+
+  Key insert(T value) {
+    sf::Uint32 index;
+    while (!freeSlots.empty() && slots[freeSlots.back()].occupied) {
+      freeSlots.pop_back();
+    }
+    if (freeSlots.empty()) {
+      index = static_cast<sf::Uint32>(slots.size());
+      slots.push_back(Slot());
+    } else {
+      index = freeSlots.back();
+      freeSlots.pop_back();
+    }
+
+    Slot& slot = slots[index];
+    Key key = makeKey(index, slot.generation);
+    occupy(slot, key, std::move(value));
+    return key;
+  }
+
+  // Stores `value` under exactly `key`, replacing whatever the slot held,
+  // including an older generation's value.
+  T& assign(Key key, T value) {
+    sf::Uint32 index = keyIndex(key);
+    if (index >= slots.size()) {
+      slots.resize(index + 1);
+    }
+
+    Slot& slot = slots[index];
+    slot.generation = keyGeneration(key);
+    if (slot.occupied) {
+      keys[slot.dense] = key;
+      values[slot.dense] = std::move(value);
+      return values[slot.dense];
+    }
+    occupy(slot, key, std::move(value));
+    return values.back();
+  }
+
+  T* find(Key key) {
+    const Slot* slot = lookup(key);
+    return slot ? &values[slot->dense] : nullptr;
+  }
+
+  const T* find(Key key) const {
+    const Slot* slot = lookup(key);
+    return slot ? &values[slot->dense] : nullptr;
+  }
+
+  bool contains(Key key) const { return lookup(key) != nullptr; }
+
+  // Moves the last value into the hole, so the rest stay packed.
+  bool erase(Key key) {
+    const Slot* found = lookup(key);
+    if (!found) {
+      return false;
+    }
+
+    sf::Uint32 index = keyIndex(key);
+    std::size_t dense = found->dense;
+    std::size_t last = values.size() - 1;
+    if (dense != last) {
+      values[dense] = std::move(values[last]);
+      keys[dense] = keys[last];
+      slots[keyIndex(keys[dense])].dense = dense;
+    }
+    values.pop_back();
+    keys.pop_back();
+
+    Slot& slot = slots[index];
+    slot.occupied = false;
+    slot.generation = slot.generation == 255 ? 1 : slot.generation + 1;
+    freeSlots.push_back(index);
+    return true;
+  }
+
+  template <typename Predicate>
+  void eraseIf(Predicate predicate) {
+    for (std::size_t i = values.size(); i-- > 0;) {
+      if (predicate(values[i])) {
+        erase(keys[i]);
+      }
+    }
+  }
+
+  void clear() {
+    values.clear();
+    keys.clear();
+    slots.clear();
+    freeSlots.clear();
+  }
+
+  std::size_t size() const { return values.size(); }
+  bool empty() const { return values.empty(); }
+
+  // The packed values, in no particular order, and the key of each.
+  const std::vector<T>& getValues() const { return values; }
+  Key keyAt(std::size_t dense) const { return keys[dense]; }
+
+  typename std::vector<T>::iterator begin() { return values.begin(); }
+  typename std::vector<T>::iterator end() { return values.end(); }
+  typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+  typename std::vector<T>::const_iterator end() const { return values.end(); }
+
+ private:
+  struct Slot {
+    std::size_t dense = 0;
+    sf::Uint8 generation = 1;
+    bool occupied = false;
+  };
+
+  const Slot* lookup(Key key) const {
+    sf::Uint32 index = keyIndex(key);
+    if (index >= slots.size()) {
+      return nullptr;
+    }
+    const Slot& slot = slots[index];
+    return slot.occupied && slot.generation == keyGeneration(key) ? &slot : nullptr;
+  }
+
+  void occupy(Slot& slot, Key key, T&& value) {
+    slot.dense = values.size();
+    slot.occupied = true;
+    values.push_back(std::move(value));
+    keys.push_back(key);
+  }
+
+  std::vector<T> values;
+  std::vector<Key> keys;
+  std::vector<Slot> slots;
+  std::vector<sf::Uint32> freeSlots;
+};
+
+#endif // ENTITY_TABLE_H
@@ -0,0 +1,37 @@
+#include "FixedTimestep.h"
+
+namespace {
+  // A frame that banks more than this many steps (a window drag, a stall in
+  // the loader) only runs this many; the rest are dropped so the loop does
+  // not spend the next frames catching up and fall further behind.
+  const unsigned int MAX_CATCH_UP_STEPS = 5;
+}
+
+FixedTimestep::FixedTimestep(unsigned int stepRate)
+  : step(sf::seconds(1.0f / (stepRate > 0 ? stepRate : 1))), droppedSteps(0) {
+}
+
+void FixedTimestep::advance(sf::Time elapsed) {
+  if (elapsed < sf::Time::Zero) {
+    return;
+  }
+
+  accumulator += elapsed;
+  sf::Time limit = step * static_cast<float>(MAX_CATCH_UP_STEPS);
+  if (accumulator > limit) {
+    droppedSteps += static_cast<unsigned int>((accumulator - limit) / step);
+    accumulator = limit;
+  }
+}
+
+bool FixedTimestep::consumeStep() {
+  if (accumulator < step) {
+    return false;
+  }
+  accumulator -= step;
+  return true;
+}
+
+float FixedTimestep::getAlpha() const {
+  return accumulator / step;
+}
@@ -0,0 +1,33 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <SFML/System.hpp>
+
+// Fixed-step clock for the client's simulation, driven from a render loop
+// that runs at whatever rate the display allows. Each frame banks its
+// elapsed time with advance(), the game runs one update per consumeStep()
+// that succeeds, and whatever is left over - less than one step - becomes
+// the alpha the frame is drawn at, between the last two simulated states.
+// Movement then advances by the same amount per step on every machine.
+class FixedTimestep {
+ public:
+  explicit FixedTimestep(unsigned int stepRate);
+
+  sf::Time getStep() const { return step; }
+  float getStepSeconds() const { return step.asSeconds(); }
+
+  void advance(sf::Time elapsed);
+  bool consumeStep();
+  // How far past the last step the frame is, from 0 up to (not including) 1.
+  float getAlpha() const;
+
+  // Steps dropped because a frame took too long to catch up on.
+  unsigned int getDroppedSteps() const { return droppedSteps; }
+
+ private:
+  sf::Time step;
+  sf::Time accumulator;
+  unsigned int droppedSteps;
+};
+
+#endif // FIXED_TIMESTEP_H
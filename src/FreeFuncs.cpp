@@ -126,6 +126,91 @@ bool tmx::decompress(const char* source, std::vector<unsigned char>& dest, std::
     return true;
 }
 
+bool tmx::decompress(const std::function<std::size_t(unsigned char*, std::size_t)>& read,
+    const std::function<bool(const unsigned char*, std::size_t)>& write)
+{
+    //one block of each side is all that's ever held. The input block is a
+    //multiple of 3 bytes, which lets a base64 reader fill it group by group
+    unsigned char input[12 * 1024];
+    unsigned char output[16 * 1024];
+
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+#ifdef USE_EXTLIBS
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+#else
+    if (inflateInit(&stream) != Z_OK)
+#endif
+    {
+        LOG("inflate init failed", Logger::Type::Error);
+        return false;
+    }
+
+    bool moreInput = true;
+    bool outputFull = false;
+    int result = Z_OK;
+    while (result != Z_STREAM_END)
+    {
+        if (stream.avail_in == 0 && moreInput)
+        {
+            stream.next_in = input;
+            stream.avail_in = static_cast<unsigned int>(read(input, sizeof(input)));
+            moreInput = stream.avail_in != 0;
+        }
+
+        //inflate may still be holding output from the last block even
+        //once the input has run out
+        if (stream.avail_in == 0 && !moreInput && !outputFull)
+        {
+            break;
+        }
+
+        stream.next_out = output;
+        stream.avail_out = sizeof(output);
+        result = inflate(&stream, Z_SYNC_FLUSH);
+
+        switch (result)
+        {
+        default: break;
+        case Z_NEED_DICT:
+        case Z_STREAM_ERROR:
+            result = Z_DATA_ERROR;
+            [[fallthrough]];
+        case Z_DATA_ERROR:
+            Logger::log("If using gzip or zstd compression try using zlib instead", Logger::Type::Info);
+            [[fallthrough]];
+        case Z_MEM_ERROR:
+            inflateEnd(&stream);
+            Logger::log("inflate() returned " + std::to_string(result), Logger::Type::Error);
+            return false;
+        }
+
+        const std::size_t outSize = sizeof(output) - stream.avail_out;
+        outputFull = stream.avail_out == 0;
+        if (outSize != 0 && !write(output, outSize))
+        {
+            //the writer has all it wants, which is as good as the end
+            inflateEnd(&stream);
+            return true;
+        }
+    }
+
+    inflateEnd(&stream);
+
+    //input which runs out before the end of the stream is truncated or corrupt
+    if (result != Z_STREAM_END)
+    {
+        Logger::log("Compressed data ended before the end of the stream", Logger::Type::Error);
+        return false;
+    }
+    return true;
+}
+
 std::ostream& operator << (std::ostream& os, const tmx::Colour& c)
 {
     os << "RGBA: " << (int)c.r << ", " << (int)c.g << ", " << (int)c.b << ", " << (int)c.a;
@@ -1,11 +1,20 @@
 #include "Game.h"
+#include "Protocol.h"
+#include "ResourceCache.h"
 #include <chrono>
 #include <tmxlite/map.hpp>
 #include <math.h>
+#include <algorithm>
+
+namespace {
+  // Simulation steps per second; the window is capped at the same rate.
+  const unsigned int SIMULATION_RATE = 60;
+}
 
 Game::Game(sf::RenderWindow& game_window, bool server)
   : window(game_window), isServer(server), isTextBoxActive(false),
-  player(1, sf::Vector2f(100.0f, 100.0f)), windowFocused(true) {
+  player(1, sf::Vector2f(100.0f, 100.0f)), windowFocused(true),
+  previousPlayerPosition(player.getPosition()), timestep(SIMULATION_RATE) {
   srand(time(NULL));
 
   textBox.setSize(sf::Vector2f(400, 50));
@@ -15,11 +24,9 @@ Game::Game(sf::RenderWindow& game_window, bool server)
   chatOutputBox.setFillColor(sf::Color(0, 0, 255, 150));
   chatOutputBox.setPosition(10, window.getSize().y - 210);
 
-  if (!font.loadFromFile("Data/Fonts/OpenSans-Bold.ttf")) {
-    std::cerr << "Failed to load font." << std::endl;
-  }
+  font = ResourceCache::shared().getFont("Data/Fonts/OpenSans-Bold.ttf");
 
-  textDisplay.setFont(font);
+  textDisplay.setFont(*font);
   textDisplay.setCharacterSize(24);
   textDisplay.setFillColor(sf::Color::White);
   textDisplay.setPosition(textBox.getPosition() + sf::Vector2f(5, 5));
@@ -29,80 +36,38 @@ Game::~Game() {
 
 }
 
-void Game::SetTileWithID(
-  const unsigned int MAP_COLUMNS, const unsigned int MAP_ROWS,
-  const tmx::Vector2u& tile_size, const tmx::TileLayer::Tile& tile)
-{
-  float scaleFactor = 3.5f;
-  auto& current = *TILE_MAP.back().emplace_back(
-    std::make_unique<Tile>(tile.ID, *tileMap));
-
-  int tileID = tile.ID - 1;
-
-  if (tileID < 0) {
-    current.GetSprite()->setTextureRect(sf::IntRect(0, 0, 0, 0));
-  } else {
-    int tilesPerRow = tileMap->getSize().x / tile_size.x;
-    sf::IntRect textureRect(
-      (tileID % tilesPerRow) * tile_size.x,
-      (tileID / tilesPerRow) * tile_size.y,
-      tile_size.x,
-      tile_size.y
-    );
-    current.GetSprite()->setTextureRect(textureRect);
-  }
-
-  int tileIndex = static_cast<int>(TILE_MAP.back().size() - 1);
-  sf::Vector2f position(
-    (tileIndex % MAP_COLUMNS) * tile_size.x * scaleFactor,
-    (tileIndex / MAP_COLUMNS) * tile_size.y * scaleFactor
-  );
-  current.GetSprite()->setPosition(position);
-  current.GetSprite()->setScale(scaleFactor, scaleFactor);
-}
-
 bool Game::init() {
-  if (!tileMap->loadFromFile("Data/Map/tilemap.png")) {
+  tileMap = ResourceCache::shared().getTexture("Data/Map/tilemap.png");
+  if (tileMap->getSize().x == 0) {
     std::cout << "Failed to Load Spritesheet" << std::endl;
     return false;
   }
 
+  // The binary cache skips XML parsing; it's rebuilt whenever the map changes.
   tmx::Map map;
-  if (!map.load("Data/Map/Map.tmx")) {
-    std::cout << "Failed to Load Map Data" << std::endl;
-    return false;
-  }
-
-  const unsigned int MAP_COLUMNS = map.getTileCount().x;
-  const unsigned int MAP_ROWS = map.getTileCount().y;
-  auto& tile_size = map.getTileSize();
-
-  sf::Vector2u windowSize = window.getSize();
-  float xScale = static_cast<float>(windowSize.x) / (MAP_COLUMNS * tile_size.x);
-  float yScale = static_cast<float>(windowSize.y) / (MAP_ROWS * tile_size.y);
-  float scaleFactor = std::min(xScale, yScale);
-
-  TILE_MAP.reserve(map.getLayers().size());
-
-  for (const auto& layer: map.getLayers()) {
-    TILE_MAP.emplace_back(std::vector<std::unique_ptr<Tile>>());
-    const auto& tiles = layer->getLayerAs<tmx::TileLayer>().getTiles();
-    TILE_MAP.back().reserve(tiles.size());
-
-    for (const auto& tile : tiles) {
-      SetTileWithID(MAP_COLUMNS, MAP_ROWS, tile_size, tile);
+  const std::string cachePath = std::string(MAP_PATH) + MAP_CACHE_SUFFIX;
+  if (!map.loadCache(cachePath, MAP_PATH)) {
+    if (!map.load(MAP_PATH)) {
+      std::cout << "Failed to Load Map Data" << std::endl;
+      return false;
     }
+    map.saveCache(cachePath);
   }
 
+  tileMapRenderer.load(map, tileMap);
+  tileMapRenderer.setScale(MAP_SCALE, MAP_SCALE);
+  collisionGrid.build(map, MAP_SCALE);
+
   if (isServer) {
     server = std::make_unique<Server>();
+    server->loadMap(MAP_PATH);
     server->init();
     server->run();
   } else {
     client = std::make_unique<Client>(messageQueue);
+    client->setCollisionGrid(&collisionGrid);
     client->connect();
     client->run();
-    client->update();
   }
   return true;
 }
@@ -112,80 +77,68 @@ void Game::formatChatMessage(int playerId, const std::string& message) {
   messageQueue.emplace_back(formattedMessage, std::chrono::steady_clock::now());
 }
 
-bool Game::checkCollisionWithTile(const sf::Vector2f& playerPosition, const sf::Vector2f& playerSize, const sf::Vector2f& tileSize, const sf::Vector2f& tilePosition) {
-  sf::FloatRect playerRect(playerPosition.x, playerPosition.y, playerSize.x, playerSize.y);
-  sf::FloatRect tileRect(tilePosition.x, tilePosition.y, tileSize.x, tileSize.y);
+void Game::frame(sf::Time elapsed) {
+  handleEvents();
+  if (!window.isOpen()) {
+    return;
+  }
 
-  return playerRect.intersects(tileRect);
-}
+  // Once per frame, however many steps it runs: corrections and snapshots
+  // are taken as they arrive, not at a rate that depends on the step count.
+  if (client) {
+    client->poll();
+  }
 
-void Game::update(float dt) {
-  if (windowFocused) {
-    player.handleInput(window);
+  timestep.advance(elapsed);
+  while (timestep.consumeStep()) {
+    update(timestep.getStepSeconds());
   }
+  render(timestep.getAlpha());
+}
 
-  sf::Vector2f playerSize = player.getSpriteSize();
+void Game::update(float dt) {
+  previousPlayerPosition = player.getPosition();
 
-  bool collisionDetected = false;
-  for (const auto& layer : TILE_MAP) {
-    for (const auto& tile : layer) {
-      if (tile->GetID() == 2) {
-        sf::Vector2f tilePosition = tile->GetSprite()->getPosition();
-        sf::Vector2f tileSize(tileMap->getSize().x, tileMap->getSize().y);
+  sf::Uint8 buttons = windowFocused ? Player::sampleInput(window) : 0;
 
-        if (checkCollisionWithTile(player.getPosition(), playerSize, tileSize, tilePosition)) {
-          std::cout << "Collision Detected with Tile ID 2" << std::endl;
-          collisionDetected = true;
-          player.handleCollision(tilePosition, tileSize);
-          break;
-        }
-      }
+  // Predict locally: move right away and let the client correct us once the
+  // server has caught up with the inputs recorded so far.
+  if (client && client->isPredicting()) {
+    sf::Vector2f corrected;
+    if (client->takeCorrection(corrected)) {
+      player.setPosition(corrected);
     }
-    if (collisionDetected) break;
-  }
-
-  if (!collisionDetected) {
-    player.update(dt);
+    client->recordInput(buttons, dt);
   }
+  // The same step the server runs on these inputs, so the two agree.
+  player.applyInput(buttons);
+  player.setPosition(simulateMovement(collisionGrid, player.getPosition(), buttons, dt));
+  player.update(dt);
 
   if (client) {
-    const auto& otherPlayerPositions = client->getPlayerPositions();
-    for (const auto& [playerId, position] : otherPlayerPositions) {
-      updatePlayerPosition(playerId, position);
+    // Without UDP inputs the client still reports positions, so keep the one
+    // it sends in step with the player we move.
+    if (!client->isPredicting()) {
+      client->setLocalPosition(player.getPosition());
     }
 
-    const auto& newMessages = client->getPlayerChatMessages();
-    for (const auto& [playerId, messages] : newMessages) {
-      for (const auto& message : messages) {
-        if (playerId != client->getLocalPlayer()->getId()) {
-          formatChatMessage(playerId, message);
-        }
-      }
-    }
-    client->clearReceivedMessages();
+    client->sampleRemotePlayers(remotePositions);
+    remotePlayers.setPositions(remotePositions, dt);
   }
 
-  for (auto& p : players) {
-    p.update(dt);
-  }
+  remotePlayers.animate(dt);
 }
 
-void Game::render() {
+void Game::render(float alpha) {
   window.clear();
 
-  for (const auto& layer : TILE_MAP) {
-    for (const auto& tile : layer) {
-      if (tile->GetID() != 0) {
-        window.draw(*tile->GetSprite());
-      }
-    }
-  }
+  window.draw(tileMapRenderer);
 
-  player.draw(window, font);
+  player.setRenderPosition(previousPlayerPosition + (player.getPosition() - previousPlayerPosition) * alpha);
+  player.draw(window, *font);
 
-  for (const auto& p : players) {
-    p.draw(window, font);
-  }
+  remotePlayers.setRenderAlpha(alpha);
+  window.draw(remotePlayers);
 
   auto currentTime = std::chrono::steady_clock::now();
   sf::Vector2f chatPos(10, window.getSize().y - 200);
@@ -194,7 +147,7 @@ void Game::render() {
     if (currentTime - timestamp > std::chrono::seconds(5)) {
       it = messageQueue.erase(it);
     } else {
-      sf::Text chatText(message, font, 20);
+      sf::Text chatText(message, *font, 20);
       chatText.setPosition(chatPos);
       chatText.setFillColor(sf::Color::White);
       window.draw(chatText);
@@ -211,21 +164,6 @@ void Game::render() {
   window.display();
 }
 
-void Game::updatePlayerPosition(int playerId, sf::Vector2f newPosition) {
-  if (playerId == player.getId()) {
-    return;
-  }
-
-  auto it = std::find_if(players.begin(), players.end(),
-                         [playerId](const Player& p) { return p.getId() == playerId; });
-  if (it != players.end()) {
-    it->setPosition(newPosition);
-  } else {
-    Player newPlayer(playerId, newPosition);
-    players.push_back(newPlayer);
-  }
-}
-
 void Game::handleEvents() {
   sf::Event event;
   while (window.pollEvent(event)) {
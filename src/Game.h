@@ -4,7 +4,10 @@
 #include "Client.h" // Include the necessary header for the client
 #include "Player.h" // Include the Player class
 #include "Server.h" // Include the necessary header for the server
-#include "Tile.h"
+#include "CollisionGrid.h"
+#include "EntityStore.h"
+#include "FixedTimestep.h"
+#include "TileMapRenderer.h"
 #include <SFML/Graphics.hpp>
 #include <chrono>
 #include <iostream>
@@ -13,6 +16,7 @@
 #include <tmxlite/Types.hpp>
 #include <utility>
 #include <memory>
+#include <unordered_map>
 class Game
 {
  public:
@@ -20,16 +24,17 @@ class Game
   Game(sf::RenderWindow& game_window, bool server);
   ~Game();
   void handleInput(sf::TcpSocket& socket);
-  bool checkCollisionWithTile(const sf::Vector2f& playerPosition, const sf::Vector2f& playerSize, const sf::Vector2f& tileSize, const sf::Vector2f& tilePosition);
 
   bool init();
   bool windowFocused = true;
-  void SetTileWithID(const unsigned int MAP_COLUMNS, const unsigned int MAP_ROWS, const tmx::Vector2<unsigned int> &tile_size,
-                     const tmx::TileLayer::Tile &tile);
+  // One pass of the main loop: handle events, run as many fixed update
+  // steps as `elapsed` pays for, then render once at the leftover alpha.
+  void frame(sf::Time elapsed);
+  // A single simulation step of the fixed length given by the timestep.
   void update(float dt);
-  void render();
+  // Draws the world `alpha` of the way from the previous step to the latest.
+  void render(float alpha);
   void mouseClicked(sf::Event event);
-  void updatePlayerPosition(int playerId, sf::Vector2f newPosition);
   void handleEvents();
   void keyPressed(sf::Event event);
 
@@ -46,7 +51,9 @@ class Game
     return windowFocused;
   }
 
-  std::vector<Player> players;
+  // Remote players, keyed by the IDs the server gave them. The local
+  // player is not in here; Client::sampleRemotePlayers leaves it out.
+  EntityStore remotePlayers;
 
  private:
   sf::RenderWindow& window;
@@ -56,17 +63,23 @@ class Game
   sf::Text textDisplay;
   sf::RectangleShape chatOutputBox;
   bool isServer;
-  sf::Font font;
+  std::shared_ptr<const sf::Font> font;
   std::string chatInput;
-  std::unique_ptr<sf::Texture> tileMap = std::make_unique<sf::Texture>();
-  std::vector<std::vector<std::unique_ptr<Tile>>> TILE_MAP;
+  std::shared_ptr<const sf::Texture> tileMap;
+  TileMapRenderer tileMapRenderer;
+  CollisionGrid collisionGrid;
   std::unique_ptr<Client> client;
+  // Reused every frame for Client::sampleRemotePlayers.
+  std::unordered_map<int, sf::Vector2f> remotePositions;
   std::unique_ptr<Server> server;
   std::vector<Client> clients;
 
   std::vector<sf::Text> chatMessagesDisplay;
 
   Player player;  // Include the Player object in your Game class
+  // Where the local player was before the latest step, for render().
+  sf::Vector2f previousPlayerPosition;
+  FixedTimestep timestep;
 };
 
 #endif // GAME_H
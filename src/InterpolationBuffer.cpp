@@ -0,0 +1,53 @@
+#include "InterpolationBuffer.h"
+
+void InterpolationBuffer::push(sf::Time time, const sf::Vector2f& position) {
+  if (count < CAPACITY) {
+    samples[(head + count++) % CAPACITY] = {time, position};
+  } else {
+    samples[head] = {time, position};
+    head = (head + 1) % CAPACITY;
+  }
+}
+
+sf::Vector2f InterpolationBuffer::sample(sf::Time time, sf::Time maxExtrapolation) const {
+  if (count == 0) {
+    return sf::Vector2f();
+  }
+
+  const Sample& oldest = at(0);
+  if (time <= oldest.time) {
+    return oldest.position;
+  }
+
+  const Sample& newest = at(count - 1);
+  if (time >= newest.time) {
+    if (count < 2 || maxExtrapolation <= sf::Time::Zero) {
+      return newest.position;
+    }
+
+    const Sample& previous = at(count - 2);
+    float span = (newest.time - previous.time).asSeconds();
+    if (span <= 0.0f) {
+      return newest.position;
+    }
+
+    // Out to maxExtrapolation along the last velocity, then back again.
+    sf::Time late = time - newest.time;
+    sf::Time ahead = late <= maxExtrapolation ? late : maxExtrapolation + maxExtrapolation - late;
+    if (ahead <= sf::Time::Zero) {
+      return newest.position;
+    }
+    sf::Vector2f velocity = (newest.position - previous.position) / span;
+    return newest.position + velocity * ahead.asSeconds();
+  }
+
+  // Samples are few, so a linear walk back from the newest is cheap.
+  std::size_t index = count - 1;
+  while (index > 0 && at(index - 1).time > time) {
+    --index;
+  }
+  const Sample& from = at(index - 1);
+  const Sample& to = at(index);
+  float t = (time - from.time).asSeconds() / (to.time - from.time).asSeconds();
+  return from.position + (to.position - from.position) * t;
+}
@@ -0,0 +1,37 @@
+#ifndef INTERPOLATION_BUFFER_H
+#define INTERPOLATION_BUFFER_H
+
+#include <SFML/System.hpp>
+#include <array>
+
+// The last few positions received for one remote entity, each stamped with
+// the local time it arrived. Rendering asks for the position at a time a
+// little in the past, which normally falls between two samples and is
+// interpolated; if updates are late and the time is past the newest sample,
+// the entity keeps moving at its last velocity for at most `maxExtrapolation`
+// and then eases back onto the newest sample over the same time.
+class InterpolationBuffer {
+ public:
+  static const std::size_t CAPACITY = 16;
+
+  // Samples must be pushed in time order; older ones drop off the end.
+  void push(sf::Time time, const sf::Vector2f& position);
+  bool empty() const { return count == 0; }
+
+  sf::Vector2f sample(sf::Time time, sf::Time maxExtrapolation) const;
+
+ private:
+  struct Sample {
+    sf::Time time;
+    sf::Vector2f position;
+  };
+
+  // 0 is the oldest sample held, count - 1 the newest.
+  const Sample& at(std::size_t index) const { return samples[(head + index) % CAPACITY]; }
+
+  std::array<Sample, CAPACITY> samples;
+  std::size_t head = 0;
+  std::size_t count = 0;
+};
+
+#endif // INTERPOLATION_BUFFER_H
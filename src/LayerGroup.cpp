@@ -31,6 +31,7 @@ source distribution.
 #include "detail/pugixml.hpp"
 #endif
 #include <tmxlite/LayerGroup.hpp>
+#include <tmxlite/Map.hpp>
 #include <tmxlite/FreeFuncs.hpp>
 #include <tmxlite/ObjectGroup.hpp>
 #include <tmxlite/ImageLayer.hpp>
@@ -84,7 +85,7 @@ void LayerGroup::parse(const pugi::xml_node& node, Map* map)
         else if (attribString == "layer")
         {
             m_layers.emplace_back(std::make_unique<TileLayer>(m_tileCount.x * m_tileCount.y));
-            m_layers.back()->parse(child, map);
+            map->parseTileLayer(*m_layers.back(), child);
         }
         else if (attribString == "objectgroup")
         {
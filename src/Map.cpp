@@ -38,8 +38,15 @@ source distribution.
 #include <tmxlite/LayerGroup.hpp>
 #include <tmxlite/detail/Log.hpp>
 #include <tmxlite/detail/Android.hpp>
+#include "detail/MapCache.hpp"
+#include "detail/Threads.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <queue>
+#include <thread>
 
 using namespace tmx;
 
@@ -49,7 +56,9 @@ Map::Map()
     m_infinite      (false),
     m_hexSideLength (0.f),
     m_staggerAxis   (StaggerAxis::None),
-    m_staggerIndex  (StaggerIndex::None)
+    m_staggerIndex  (StaggerIndex::None),
+    m_sourceHash    (0),
+    m_loadThreadCount(1)
 {
 
 }
@@ -89,7 +98,34 @@ bool Map::load(const std::string& path)
         return reset();
     }
 
-    return parseMapNode(mapNode);
+    if (!parseMapNode(mapNode))
+    {
+        return false;
+    }
+
+    //remember what the map was read from, so a cache made from it can
+    //tell when the files change. They're only hashed if a cache is saved
+    m_sourceFiles.push_back(path);
+    for (const auto& node : mapNode.children("tileset"))
+    {
+        if (node.attribute("source"))
+        {
+            m_sourceFiles.push_back(resolveFilePath(node.attribute("source").as_string(), m_workingDirectory));
+        }
+    }
+
+    return true;
+}
+
+bool Map::saveCache(const std::string& path) const
+{
+    return detail::MapCache::save(*this, path);
+}
+
+bool Map::loadCache(const std::string& path, const std::string& mapPath)
+{
+    reset();
+    return detail::MapCache::load(*this, path, mapPath) || reset();
 }
 
 bool Map::loadFromString(const std::string& data, const std::string& workingDir)
@@ -296,7 +332,7 @@ bool Map::parseMapNode(const pugi::xml_node& mapNode)
         else if (name == "layer")
         {
             m_layers.emplace_back(std::make_unique<TileLayer>(m_tileCount.x * m_tileCount.y));
-            m_layers.back()->parse(node);
+            parseTileLayer(*m_layers.back(), node);
         }
         else if (name == "objectgroup")
         {
@@ -327,6 +363,8 @@ bool Map::parseMapNode(const pugi::xml_node& mapNode)
             LOG("Unidentified name " + name + ": node skipped", Logger::Type::Warning);
         }
     }
+    decodePendingTileLayers();
+
     // fill animated tiles for easier lookup into map
     for(const auto& ts : m_tilesets)
     {
@@ -363,5 +401,83 @@ bool Map::reset()
 
     m_animTiles.clear();
 
+    m_sourceFiles.clear();
+    m_sourceHash = 0;
+
+    m_pendingTileLayers.clear();
+
     return false;
 }
+
+void Map::parseTileLayer(Layer& layer, const pugi::xml_node& node)
+{
+    if (m_loadThreadCount == 1)
+    {
+        layer.parse(node, this);
+    }
+    else
+    {
+        //the node points into the document, which outlives parseMapNode()
+        m_pendingTileLayers.emplace_back([&layer, node, this]() { layer.parse(node, this); });
+    }
+}
+
+void Map::decodePendingTileLayers()
+{
+    if (m_pendingTileLayers.empty())
+    {
+        return;
+    }
+
+    std::size_t threadCount = m_loadThreadCount ? m_loadThreadCount : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, m_pendingTileLayers.size());
+
+    //each thread takes the next waiting layer until there are none left. Every
+    //layer was created in place before being queued, so the order is already set
+    std::atomic<std::size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto decode = [&]()
+    {
+        //with several threads decoding every core is already busy, so layers
+        //don't start threads of their own. A lone thread leaves them to it
+        const bool wasInPool = detail::inLoadPool();
+        detail::inLoadPool() = wasInPool || threadCount > 1;
+
+        for (auto i = next++; i < m_pendingTileLayers.size(); i = next++)
+        {
+            try
+            {
+                m_pendingTileLayers[i]();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+        detail::inLoadPool() = wasInPool;
+    };
+
+    {
+        //joins on the way out if starting a thread throws
+        detail::ThreadGroup threads;
+        for (auto i = 1u; i < threadCount; ++i)
+        {
+            threads.start(decode);
+        }
+
+        //the calling thread decodes too
+        decode();
+    }
+    m_pendingTileLayers.clear();
+
+    //same as if the layer had been parsed on this thread
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
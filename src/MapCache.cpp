@@ -0,0 +1,1054 @@
+/*********************************************************************
+Matt Marchant 2016 - 2023
+http://trederia.blogspot.com
+
+tmxlite - Zlib license.
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+you must not claim that you wrote the original software.
+If you use this software in a product, an acknowledgment
+in the product documentation would be appreciated but
+is not required.
+
+2. Altered source versions must be plainly marked as such,
+and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+source distribution.
+*********************************************************************/
+
+#include "detail/MapCache.hpp"
+
+#include <tmxlite/ImageLayer.hpp>
+#include <tmxlite/LayerGroup.hpp>
+#include <tmxlite/TileLayer.hpp>
+#include <tmxlite/detail/Log.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace tmx;
+using namespace tmx::detail;
+
+namespace
+{
+    //read only view of a whole file, mapped into memory rather than read
+    class MappedFile final
+    {
+    public:
+        explicit MappedFile(const std::string& path)
+        {
+#ifdef _WIN32
+            m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+            {
+                return;
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_file, &size))
+            {
+                return;
+            }
+            m_size = static_cast<std::size_t>(size.QuadPart);
+            m_open = true;
+            if (m_size == 0)
+            {
+                return;
+            }
+
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping)
+            {
+                m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            }
+            m_open = m_data != nullptr;
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd == -1)
+            {
+                return;
+            }
+
+            struct stat info;
+            if (fstat(fd, &info) == 0)
+            {
+                m_size = static_cast<std::size_t>(info.st_size);
+                m_open = true;
+                if (m_size != 0)
+                {
+                    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    m_data = data == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(data);
+                    m_open = m_data != nullptr;
+                }
+            }
+            //the mapping stays valid once the descriptor is closed
+            ::close(fd);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (m_data)
+            {
+                UnmapViewOfFile(m_data);
+            }
+            if (m_mapping)
+            {
+                CloseHandle(m_mapping);
+            }
+            if (m_file != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(m_file);
+            }
+#else
+            if (m_data)
+            {
+                munmap(const_cast<unsigned char*>(m_data), m_size);
+            }
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        bool isOpen() const { return m_open; }
+        const unsigned char* getData() const { return m_data; }
+        std::size_t getSize() const { return m_size; }
+
+    private:
+        const unsigned char* m_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_open = false;
+#ifdef _WIN32
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#endif
+    };
+
+    //deep enough for any real map, shallow enough that a corrupt
+    //file can't recurse through groups forever
+    constexpr std::uint32_t MaxGroupDepth = 64;
+
+    void copyColour(const Colour& src, std::uint8_t (&dest)[4])
+    {
+        dest[0] = src.r;
+        dest[1] = src.g;
+        dest[2] = src.b;
+        dest[3] = src.a;
+    }
+
+    Colour readColour(const std::uint8_t (&src)[4])
+    {
+        return Colour(src[0], src[1], src[2], src[3]);
+    }
+}
+
+std::uint64_t MapCache::hashFiles(const std::vector<std::string>& paths)
+{
+    //64 bit FNV-1a, taken a word at a time. This only has to notice that
+    //a file has changed, not stand up to anyone trying to fool it.
+    static const std::uint64_t prime = 0x100000001b3ull;
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (const auto& path : paths)
+    {
+        MappedFile file(path);
+        if (!file.isOpen())
+        {
+            return 0;
+        }
+
+        const auto* data = file.getData();
+        const auto size = file.getSize();
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * prime;
+        }
+        for (; i < size; ++i)
+        {
+            hash = (hash ^ data[i]) * prime;
+        }
+
+        //so moving bytes from one file to the next still changes the hash
+        hash = (hash ^ size) * prime;
+    }
+
+    return hash == 0 ? 1 : hash;
+}
+
+bool MapCache::save(const Map& map, const std::string& path)
+{
+    if (map.m_sourceFiles.empty())
+    {
+        Logger::log("Map cache can only be made from a map loaded from a file, " + path + " not written", Logger::Type::Error);
+        return false;
+    }
+
+    //load() doesn't hash the files, so that loading without ever saving a
+    //cache reads them only once. A map that came from a cache already has it
+    const std::uint64_t sourceHash = map.m_sourceHash != 0 ? map.m_sourceHash : hashFiles(map.m_sourceFiles);
+    if (sourceHash == 0)
+    {
+        Logger::log("Couldn't read the files " + path + " would be made from, not written", Logger::Type::Error);
+        return false;
+    }
+
+    if (!map.m_templateObjects.empty() || !map.m_templateTilesets.empty())
+    {
+        Logger::log("Maps using object templates can't be cached, " + path + " not written", Logger::Type::Warning);
+        return false;
+    }
+
+    MapCache cache;
+    for (const auto& file : map.m_sourceFiles)
+    {
+        cache.m_sourceFiles.push_back(cache.addString(file));
+    }
+
+    Header header;
+    header.sourceHash = sourceHash;
+    header.mapVersion[0] = map.m_version.upper;
+    header.mapVersion[1] = map.m_version.lower;
+    header.className = cache.addString(map.m_class);
+    header.orientation = static_cast<std::uint32_t>(map.m_orientation);
+    header.renderOrder = static_cast<std::uint32_t>(map.m_renderOrder);
+    header.staggerAxis = static_cast<std::uint32_t>(map.m_staggerAxis);
+    header.staggerIndex = static_cast<std::uint32_t>(map.m_staggerIndex);
+    header.infinite = map.m_infinite ? 1 : 0;
+    header.tileCount[0] = map.m_tileCount.x;
+    header.tileCount[1] = map.m_tileCount.y;
+    header.tileSize[0] = map.m_tileSize.x;
+    header.tileSize[1] = map.m_tileSize.y;
+    header.hexSideLength = map.m_hexSideLength;
+    header.parallaxOrigin[0] = map.m_parallaxOrigin.x;
+    header.parallaxOrigin[1] = map.m_parallaxOrigin.y;
+    copyColour(map.m_backgroundColour, header.backgroundColour);
+    header.workingDirectory = cache.addString(map.m_workingDirectory);
+    header.properties = cache.addProperties(map.m_properties);
+    header.layers = cache.addLayers(map.m_layers);
+    header.tilesets = cache.addTilesets(map.m_tilesets);
+
+    return cache.writeFile(path, header);
+}
+
+bool MapCache::load(Map& map, const std::string& path, const std::string& mapPath)
+{
+    MappedFile file(path);
+    if (!file.isOpen() || file.getSize() < sizeof(Header))
+    {
+        return false;
+    }
+
+    MapCache cache;
+    cache.m_data = file.getData();
+    cache.m_size = file.getSize();
+    cache.m_header = reinterpret_cast<const Header*>(cache.m_data);
+
+    const auto& header = *cache.m_header;
+    if (header.magic != Magic || header.version != FormatVersion)
+    {
+        LOG(path + ": map cache is from another version or machine, not loaded", Logger::Type::Info);
+        return false;
+    }
+
+    for (const auto& section : header.sections)
+    {
+        if (section.offset % 8 != 0 || section.offset > cache.m_size
+            || section.size > cache.m_size - section.offset)
+        {
+            Logger::log(path + ": map cache is damaged, not loaded", Logger::Type::Error);
+            return false;
+        }
+    }
+
+    //the TMX is read from where it is now, in case the map has moved,
+    //but the TSX files are those it used when the cache was written.
+    //If the TMX has changed to use others, its hash won't match.
+    Range sourceRange = { 0, static_cast<std::uint32_t>(header.sections[SourceFiles].size / sizeof(StringRef)) };
+    const auto* sources = cache.records<StringRef>(SourceFiles, sourceRange);
+    std::vector<std::string> sourceFiles = { mapPath };
+    for (auto i = 1u; i < sourceRange.count; ++i)
+    {
+        sourceFiles.push_back(cache.readString(sources[i]));
+    }
+
+    if (!cache.m_valid || sourceRange.count == 0 || hashFiles(sourceFiles) != header.sourceHash)
+    {
+        LOG(path + ": map cache is out of date, not loaded", Logger::Type::Info);
+        return false;
+    }
+
+    map.m_version.upper = static_cast<std::uint16_t>(header.mapVersion[0]);
+    map.m_version.lower = static_cast<std::uint16_t>(header.mapVersion[1]);
+    map.m_class = cache.readString(header.className);
+    map.m_orientation = static_cast<Orientation>(header.orientation);
+    map.m_renderOrder = static_cast<RenderOrder>(header.renderOrder);
+    map.m_staggerAxis = static_cast<StaggerAxis>(header.staggerAxis);
+    map.m_staggerIndex = static_cast<StaggerIndex>(header.staggerIndex);
+    map.m_infinite = header.infinite != 0;
+    map.m_tileCount = { header.tileCount[0], header.tileCount[1] };
+    map.m_tileSize = { header.tileSize[0], header.tileSize[1] };
+    map.m_hexSideLength = header.hexSideLength;
+    map.m_parallaxOrigin = { header.parallaxOrigin[0], header.parallaxOrigin[1] };
+    map.m_backgroundColour = readColour(header.backgroundColour);
+    map.m_workingDirectory = cache.readString(header.workingDirectory);
+    map.m_properties = cache.readProperties(header.properties);
+    map.m_layers = cache.readLayers(header.layers, 0);
+    map.m_tilesets = cache.readTilesets(header.tilesets);
+
+    if (!cache.m_valid)
+    {
+        Logger::log(path + ": map cache is damaged, not loaded", Logger::Type::Error);
+        return false;
+    }
+
+    //as parseMapNode() does
+    for (const auto& ts : map.m_tilesets)
+    {
+        for (const auto& tile : ts.getTiles())
+        {
+            if (!tile.animation.frames.empty())
+            {
+                map.m_animTiles[tile.ID + ts.getFirstGID()] = tile;
+            }
+        }
+    }
+
+    map.m_sourceFiles = std::move(sourceFiles);
+    map.m_sourceHash = header.sourceHash;
+    return true;
+}
+
+//private
+MapCache::StringRef MapCache::addString(const std::string& str)
+{
+    auto result = m_stringIndex.find(str);
+    if (result != m_stringIndex.end())
+    {
+        return result->second;
+    }
+
+    StringRef ref;
+    ref.offset = static_cast<std::uint32_t>(m_strings.size());
+    ref.length = static_cast<std::uint32_t>(str.size());
+    m_strings.insert(m_strings.end(), str.begin(), str.end());
+    m_stringIndex.emplace(str, ref);
+    return ref;
+}
+
+MapCache::Range MapCache::addProperties(const std::vector<Property>& properties)
+{
+    Range range = { static_cast<std::uint32_t>(m_properties.size()), static_cast<std::uint32_t>(properties.size()) };
+    for (const auto& property : properties)
+    {
+        PropertyRecord record;
+        record.name = addString(property.m_name);
+        record.stringValue = addString(property.m_stringValue);
+        record.type = static_cast<std::uint32_t>(property.m_type);
+        switch (property.m_type)
+        {
+        default: break;
+        case Property::Type::Boolean:
+            record.value = property.m_boolValue ? 1 : 0;
+            break;
+        case Property::Type::Float:
+            std::memcpy(&record.value, &property.m_floatValue, sizeof(record.value));
+            break;
+        case Property::Type::Int:
+        case Property::Type::Object:
+            std::memcpy(&record.value, &property.m_intValue, sizeof(record.value));
+            break;
+        }
+        copyColour(property.m_colourValue, record.colour);
+        m_properties.push_back(record);
+    }
+    return range;
+}
+
+MapCache::Range MapCache::addObjects(const std::vector<Object>& objects)
+{
+    //reserve the run first, as objects' properties and points are
+    //appended to other sections as we go
+    Range range = { static_cast<std::uint32_t>(m_objects.size()), static_cast<std::uint32_t>(objects.size()) };
+    m_objects.resize(m_objects.size() + objects.size());
+
+    for (auto i = 0u; i < objects.size(); ++i)
+    {
+        const auto& object = objects[i];
+
+        ObjectRecord record;
+        record.uid = object.m_UID;
+        record.name = addString(object.m_name);
+        record.className = addString(object.m_class);
+        record.position[0] = object.m_position.x;
+        record.position[1] = object.m_position.y;
+        record.aabb[0] = object.m_AABB.left;
+        record.aabb[1] = object.m_AABB.top;
+        record.aabb[2] = object.m_AABB.width;
+        record.aabb[3] = object.m_AABB.height;
+        record.rotation = object.m_rotation;
+        record.tileID = object.m_tileID;
+        record.flipFlags = object.m_flipFlags;
+        record.visible = object.m_visible ? 1 : 0;
+        record.shape = static_cast<std::uint32_t>(object.m_shape);
+
+        record.points = { static_cast<std::uint32_t>(m_points.size() / 2), static_cast<std::uint32_t>(object.m_points.size()) };
+        for (const auto& point : object.m_points)
+        {
+            m_points.push_back(point.x);
+            m_points.push_back(point.y);
+        }
+
+        record.properties = addProperties(object.m_properties);
+        record.tilesetName = addString(object.m_tilesetName);
+
+        const auto& text = object.m_textData;
+        record.fontFamily = addString(text.fontFamily);
+        record.textContent = addString(text.content);
+        record.pixelSize = text.pixelSize;
+        record.textFlags = (text.wrap ? Wrap : 0) | (text.bold ? Bold : 0) | (text.italic ? Italic : 0)
+            | (text.underline ? Underline : 0) | (text.strikethough ? Strikethrough : 0) | (text.kerning ? Kerning : 0);
+        record.hAlign = static_cast<std::uint32_t>(text.hAlign);
+        record.vAlign = static_cast<std::uint32_t>(text.vAlign);
+        copyColour(text.colour, record.textColour);
+
+        m_objects[range.first + i] = record;
+    }
+    return range;
+}
+
+MapCache::Range MapCache::addLayers(const std::vector<Layer::Ptr>& layers)
+{
+    //siblings are kept together so a group can refer to its children as
+    //one range; their own children follow after
+    Range range = { static_cast<std::uint32_t>(m_layers.size()), static_cast<std::uint32_t>(layers.size()) };
+    m_layers.resize(m_layers.size() + layers.size());
+
+    for (auto i = 0u; i < layers.size(); ++i)
+    {
+        fillLayer(range.first + i, *layers[i]);
+    }
+    return range;
+}
+
+std::uint32_t MapCache::addObjectGroup(const ObjectGroup& group)
+{
+    auto index = static_cast<std::uint32_t>(m_layers.size());
+    m_layers.emplace_back();
+    fillLayer(index, group);
+    return index;
+}
+
+void MapCache::fillLayer(std::uint32_t index, const Layer& layer)
+{
+    //m_layers may grow while this is filled in, so the record is
+    //only stored at the end
+    LayerRecord record;
+    record.type = static_cast<std::uint32_t>(layer.getType());
+    record.name = addString(layer.m_name);
+    record.className = addString(layer.m_class);
+    record.opacity = layer.m_opacity;
+    record.visible = layer.m_visible ? 1 : 0;
+    record.offset[0] = layer.m_offset.x;
+    record.offset[1] = layer.m_offset.y;
+    record.parallaxFactor[0] = layer.m_parallaxFactor.x;
+    record.parallaxFactor[1] = layer.m_parallaxFactor.y;
+    copyColour(layer.m_tintColour, record.tintColour);
+    record.size[0] = layer.m_size.x;
+    record.size[1] = layer.m_size.y;
+    record.properties = addProperties(layer.m_properties);
+
+    switch (layer.getType())
+    {
+    case Layer::Type::Tile:
+    {
+        const auto& tileLayer = static_cast<const TileLayer&>(layer);
+        record.expectedTiles = static_cast<std::uint32_t>(tileLayer.m_tileCount);
+
+        auto addTiles = [&](const std::vector<TileLayer::Tile>& tiles)
+        {
+            Range tileRange = { static_cast<std::uint32_t>(m_tileIDs.size()), static_cast<std::uint32_t>(tiles.size()) };
+            for (const auto& tile : tiles)
+            {
+                m_tileIDs.push_back(tile.ID | static_cast<std::uint32_t>(tile.flipFlags) << 28);
+            }
+            return tileRange;
+        };
+
+        record.tiles = addTiles(tileLayer.m_tiles);
+        record.chunks = { static_cast<std::uint32_t>(m_chunks.size()), static_cast<std::uint32_t>(tileLayer.m_chunks.size()) };
+        for (const auto& chunk : tileLayer.m_chunks)
+        {
+            ChunkRecord chunkRecord;
+            chunkRecord.position[0] = chunk.position.x;
+            chunkRecord.position[1] = chunk.position.y;
+            chunkRecord.size[0] = chunk.size.x;
+            chunkRecord.size[1] = chunk.size.y;
+            chunkRecord.tiles = addTiles(chunk.tiles);
+            m_chunks.push_back(chunkRecord);
+        }
+    }
+        break;
+    case Layer::Type::Object:
+    {
+        const auto& group = static_cast<const ObjectGroup&>(layer);
+        copyColour(group.m_colour, record.colour);
+        record.drawOrder = static_cast<std::uint32_t>(group.m_drawOrder);
+        record.objects = addObjects(group.m_objects);
+        record.groupProperties = addProperties(group.m_properties);
+    }
+        break;
+    case Layer::Type::Image:
+    {
+        const auto& image = static_cast<const ImageLayer&>(layer);
+        record.workingDirectory = addString(image.m_workingDir);
+        record.imagePath = addString(image.m_filePath);
+        copyColour(image.m_transparencyColour, record.transparencyColour);
+        record.hasTransparency = image.m_hasTransparency ? 1 : 0;
+        record.imageSize[0] = image.m_imageSize.x;
+        record.imageSize[1] = image.m_imageSize.y;
+        record.repeat[0] = image.m_hasRepeatX ? 1 : 0;
+        record.repeat[1] = image.m_hasRepeatY ? 1 : 0;
+    }
+        break;
+    case Layer::Type::Group:
+    {
+        const auto& group = static_cast<const LayerGroup&>(layer);
+        record.workingDirectory = addString(group.m_workingDir);
+        record.tileCount[0] = group.m_tileCount.x;
+        record.tileCount[1] = group.m_tileCount.y;
+        record.layers = addLayers(group.m_layers);
+    }
+        break;
+    }
+
+    m_layers[index] = record;
+}
+
+MapCache::Range MapCache::addTilesets(const std::vector<Tileset>& tilesets)
+{
+    Range range = { static_cast<std::uint32_t>(m_tilesets.size()), static_cast<std::uint32_t>(tilesets.size()) };
+    for (const auto& tileset : tilesets)
+    {
+        TilesetRecord record;
+        record.workingDirectory = addString(tileset.m_workingDir);
+        record.source = addString(tileset.m_source);
+        record.name = addString(tileset.m_name);
+        record.className = addString(tileset.m_class);
+        record.imagePath = addString(tileset.m_imagePath);
+        record.firstGID = tileset.m_firstGID;
+        record.tileSize[0] = tileset.m_tileSize.x;
+        record.tileSize[1] = tileset.m_tileSize.y;
+        record.spacing = tileset.m_spacing;
+        record.margin = tileset.m_margin;
+        record.tileCount = tileset.m_tileCount;
+        record.columnCount = tileset.m_columnCount;
+        record.objectAlignment = static_cast<std::uint32_t>(tileset.m_objectAlignment);
+        record.tileOffset[0] = tileset.m_tileOffset.x;
+        record.tileOffset[1] = tileset.m_tileOffset.y;
+        record.imageSize[0] = tileset.m_imageSize.x;
+        record.imageSize[1] = tileset.m_imageSize.y;
+        copyColour(tileset.m_transparencyColour, record.transparencyColour);
+        record.hasTransparency = tileset.m_hasTransparency ? 1 : 0;
+        record.properties = addProperties(tileset.m_properties);
+
+        record.terrains = { static_cast<std::uint32_t>(m_terrains.size()), static_cast<std::uint32_t>(tileset.m_terrainTypes.size()) };
+        for (const auto& terrain : tileset.m_terrainTypes)
+        {
+            TerrainRecord terrainRecord;
+            terrainRecord.name = addString(terrain.name);
+            terrainRecord.tileID = terrain.tileID;
+            terrainRecord.properties = addProperties(terrain.properties);
+            m_terrains.push_back(terrainRecord);
+        }
+
+        record.tileIndices = { static_cast<std::uint32_t>(m_tileIndices.size()), static_cast<std::uint32_t>(tileset.m_tileIndex.size()) };
+        m_tileIndices.insert(m_tileIndices.end(), tileset.m_tileIndex.begin(), tileset.m_tileIndex.end());
+
+        record.tiles = { static_cast<std::uint32_t>(m_tilesetTiles.size()), static_cast<std::uint32_t>(tileset.m_tiles.size()) };
+        m_tilesetTiles.resize(m_tilesetTiles.size() + tileset.m_tiles.size());
+        for (auto i = 0u; i < tileset.m_tiles.size(); ++i)
+        {
+            const auto& tile = tileset.m_tiles[i];
+
+            TilesetTileRecord tileRecord;
+            tileRecord.id = tile.ID;
+            for (auto j = 0u; j < tile.terrainIndices.size(); ++j)
+            {
+                tileRecord.terrainIndices[j] = tile.terrainIndices[j];
+            }
+            tileRecord.probability = tile.probability;
+
+            tileRecord.frames = { static_cast<std::uint32_t>(m_frames.size()), static_cast<std::uint32_t>(tile.animation.frames.size()) };
+            for (const auto& frame : tile.animation.frames)
+            {
+                m_frames.push_back({ frame.tileID, frame.duration });
+            }
+
+            tileRecord.properties = addProperties(tile.properties);
+
+            //most tiles have no collision shapes, so only those which
+            //do get a layer record
+            const auto& group = tile.objectGroup;
+            if (!group.m_objects.empty() || !group.m_properties.empty() || !group.m_name.empty())
+            {
+                tileRecord.objectGroup = addObjectGroup(group);
+            }
+
+            tileRecord.imagePath = addString(tile.imagePath);
+            tileRecord.className = addString(tile.className);
+            tileRecord.imageSize[0] = tile.imageSize.x;
+            tileRecord.imageSize[1] = tile.imageSize.y;
+            tileRecord.imagePosition[0] = tile.imagePosition.x;
+            tileRecord.imagePosition[1] = tile.imagePosition.y;
+
+            m_tilesetTiles[record.tiles.first + i] = tileRecord;
+        }
+
+        m_tilesets.push_back(record);
+    }
+    return range;
+}
+
+bool MapCache::writeFile(const std::string& path, Header& header) const
+{
+    struct SectionData final
+    {
+        const void* data;
+        std::size_t size;
+    };
+
+    const SectionData sections[SectionCount] =
+    {
+        { m_strings.data(), m_strings.size() },
+        { m_sourceFiles.data(), m_sourceFiles.size() * sizeof(StringRef) },
+        { m_properties.data(), m_properties.size() * sizeof(PropertyRecord) },
+        { m_points.data(), m_points.size() * sizeof(float) },
+        { m_objects.data(), m_objects.size() * sizeof(ObjectRecord) },
+        { m_tileIDs.data(), m_tileIDs.size() * sizeof(std::uint32_t) },
+        { m_chunks.data(), m_chunks.size() * sizeof(ChunkRecord) },
+        { m_layers.data(), m_layers.size() * sizeof(LayerRecord) },
+        { m_tilesets.data(), m_tilesets.size() * sizeof(TilesetRecord) },
+        { m_tilesetTiles.data(), m_tilesetTiles.size() * sizeof(TilesetTileRecord) },
+        { m_frames.data(), m_frames.size() * sizeof(FrameRecord) },
+        { m_terrains.data(), m_terrains.size() * sizeof(TerrainRecord) },
+        { m_tileIndices.data(), m_tileIndices.size() * sizeof(std::uint32_t) }
+    };
+
+    std::uint64_t offset = sizeof(Header);
+    for (auto i = 0; i < SectionCount; ++i)
+    {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sections[i].size;
+        offset += (sections[i].size + 7) & ~std::uint64_t(7);
+    }
+
+    //written beside the real file then moved over it, so a process
+    //loading the cache never sees half a file
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            Logger::log("Failed opening " + tempPath + " to write map cache", Logger::Type::Error);
+            return false;
+        }
+
+        static const char padding[8] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& section : sections)
+        {
+            if (section.size != 0)
+            {
+                file.write(static_cast<const char*>(section.data), section.size);
+            }
+            file.write(padding, ((section.size + 7) & ~std::size_t(7)) - section.size);
+        }
+
+        if (!file)
+        {
+            Logger::log("Failed writing map cache " + tempPath, Logger::Type::Error);
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        //rename() won't replace an existing file on Windows
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            Logger::log("Failed moving map cache to " + path, Logger::Type::Error);
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+const T* MapCache::records(Section section, Range range)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "cache records are read in place");
+
+    const auto& info = m_header->sections[section];
+    const std::uint64_t available = info.size / sizeof(T);
+    if (static_cast<std::uint64_t>(range.first) + range.count > available)
+    {
+        m_valid = false;
+        return nullptr;
+    }
+    return reinterpret_cast<const T*>(m_data + info.offset) + range.first;
+}
+
+std::string MapCache::readString(StringRef ref)
+{
+    const auto* chars = records<char>(Strings, { ref.offset, ref.length });
+    return chars ? std::string(chars, ref.length) : std::string();
+}
+
+std::vector<Property> MapCache::readProperties(Range range)
+{
+    std::vector<Property> properties;
+    const auto* records = this->records<PropertyRecord>(Properties, range);
+    if (!records)
+    {
+        return properties;
+    }
+
+    properties.resize(range.count);
+    for (auto i = 0u; i < range.count; ++i)
+    {
+        const auto& record = records[i];
+        auto& property = properties[i];
+        property.m_name = readString(record.name);
+        property.m_stringValue = readString(record.stringValue);
+        property.m_type = static_cast<Property::Type>(record.type);
+        switch (property.m_type)
+        {
+        default: break;
+        case Property::Type::Boolean:
+            property.m_boolValue = record.value != 0;
+            break;
+        case Property::Type::Float:
+            std::memcpy(&property.m_floatValue, &record.value, sizeof(record.value));
+            break;
+        case Property::Type::Int:
+        case Property::Type::Object:
+            std::memcpy(&property.m_intValue, &record.value, sizeof(record.value));
+            break;
+        }
+        property.m_colourValue = readColour(record.colour);
+    }
+    return properties;
+}
+
+std::vector<Object> MapCache::readObjects(Range range)
+{
+    std::vector<Object> objects;
+    const auto* records = this->records<ObjectRecord>(Objects, range);
+    if (!records)
+    {
+        return objects;
+    }
+
+    objects.resize(range.count);
+    for (auto i = 0u; i < range.count; ++i)
+    {
+        const auto& record = records[i];
+        auto& object = objects[i];
+        object.m_UID = record.uid;
+        object.m_name = readString(record.name);
+        object.m_class = readString(record.className);
+        object.m_position = { record.position[0], record.position[1] };
+        object.m_AABB = { record.aabb[0], record.aabb[1], record.aabb[2], record.aabb[3] };
+        object.m_rotation = record.rotation;
+        object.m_tileID = record.tileID;
+        object.m_flipFlags = static_cast<std::uint8_t>(record.flipFlags);
+        object.m_visible = record.visible != 0;
+        object.m_shape = static_cast<Object::Shape>(record.shape);
+
+        const auto* points = this->records<float>(Points, { record.points.first * 2, record.points.count * 2 });
+        if (points)
+        {
+            object.m_points.reserve(record.points.count);
+            for (auto j = 0u; j < record.points.count; ++j)
+            {
+                object.m_points.emplace_back(points[j * 2], points[j * 2 + 1]);
+            }
+        }
+
+        object.m_properties = readProperties(record.properties);
+        object.m_tilesetName = readString(record.tilesetName);
+
+        auto& text = object.m_textData;
+        text.fontFamily = readString(record.fontFamily);
+        text.content = readString(record.textContent);
+        text.pixelSize = record.pixelSize;
+        text.wrap = (record.textFlags & Wrap) != 0;
+        text.bold = (record.textFlags & Bold) != 0;
+        text.italic = (record.textFlags & Italic) != 0;
+        text.underline = (record.textFlags & Underline) != 0;
+        text.strikethough = (record.textFlags & Strikethrough) != 0;
+        text.kerning = (record.textFlags & Kerning) != 0;
+        text.hAlign = static_cast<Text::HAlign>(record.hAlign);
+        text.vAlign = static_cast<Text::VAlign>(record.vAlign);
+        text.colour = readColour(record.textColour);
+    }
+    return objects;
+}
+
+std::vector<Layer::Ptr> MapCache::readLayers(Range range, std::uint32_t depth)
+{
+    std::vector<Layer::Ptr> layers;
+    const auto* records = this->records<LayerRecord>(Layers, range);
+    if (!records || depth > MaxGroupDepth)
+    {
+        m_valid = false;
+        return layers;
+    }
+
+    layers.reserve(range.count);
+    for (auto i = 0u; i < range.count; ++i)
+    {
+        auto layer = readLayer(records[i], depth);
+        if (!layer)
+        {
+            m_valid = false;
+            break;
+        }
+        layers.push_back(std::move(layer));
+    }
+    return layers;
+}
+
+Layer::Ptr MapCache::readLayer(const LayerRecord& record, std::uint32_t depth)
+{
+    Layer::Ptr layer;
+    switch (static_cast<Layer::Type>(record.type))
+    {
+    default:
+        return nullptr;
+    case Layer::Type::Tile:
+    {
+        auto tileLayer = std::make_unique<TileLayer>(record.expectedTiles);
+
+        //each GID is split into ID and flip flags as TileLayer::createTiles() does
+        auto readTiles = [&](Range tileRange, std::vector<TileLayer::Tile>& tiles)
+        {
+            const auto* ids = records<std::uint32_t>(TileIDs, tileRange);
+            if (!ids)
+            {
+                return;
+            }
+
+            static const std::uint32_t mask = 0xf0000000;
+            tiles.resize(tileRange.count);
+            for (auto i = 0u; i < tileRange.count; ++i)
+            {
+                tiles[i].flipFlags = ((ids[i] & mask) >> 28);
+                tiles[i].ID = ids[i] & ~mask;
+            }
+        };
+
+        readTiles(record.tiles, tileLayer->m_tiles);
+
+        const auto* chunks = records<ChunkRecord>(Chunks, record.chunks);
+        if (chunks)
+        {
+            tileLayer->m_chunks.resize(record.chunks.count);
+            for (auto i = 0u; i < record.chunks.count; ++i)
+            {
+                auto& chunk = tileLayer->m_chunks[i];
+                chunk.position = { chunks[i].position[0], chunks[i].position[1] };
+                chunk.size = { chunks[i].size[0], chunks[i].size[1] };
+                readTiles(chunks[i].tiles, chunk.tiles);
+            }
+        }
+        layer = std::move(tileLayer);
+    }
+        break;
+    case Layer::Type::Object:
+    {
+        auto group = std::make_unique<ObjectGroup>();
+        readObjectGroup(record, *group);
+        layer = std::move(group);
+    }
+        break;
+    case Layer::Type::Image:
+    {
+        auto image = std::make_unique<ImageLayer>(readString(record.workingDirectory));
+        image->m_filePath = readString(record.imagePath);
+        image->m_transparencyColour = readColour(record.transparencyColour);
+        image->m_hasTransparency = record.hasTransparency != 0;
+        image->m_imageSize = { record.imageSize[0], record.imageSize[1] };
+        image->m_hasRepeatX = record.repeat[0] != 0;
+        image->m_hasRepeatY = record.repeat[1] != 0;
+        layer = std::move(image);
+    }
+        break;
+    case Layer::Type::Group:
+    {
+        auto group = std::make_unique<LayerGroup>(readString(record.workingDirectory), Vector2u(record.tileCount[0], record.tileCount[1]));
+        group->m_layers = readLayers(record.layers, depth + 1);
+        layer = std::move(group);
+    }
+        break;
+    }
+
+    layer->m_name = readString(record.name);
+    layer->m_class = readString(record.className);
+    layer->m_opacity = record.opacity;
+    layer->m_visible = record.visible != 0;
+    layer->m_offset = { record.offset[0], record.offset[1] };
+    layer->m_parallaxFactor = { record.parallaxFactor[0], record.parallaxFactor[1] };
+    layer->m_tintColour = readColour(record.tintColour);
+    layer->m_size = { record.size[0], record.size[1] };
+    layer->m_properties = readProperties(record.properties);
+    return layer;
+}
+
+void MapCache::readObjectGroup(const LayerRecord& record, ObjectGroup& group)
+{
+    group.m_name = readString(record.name);
+    group.m_class = readString(record.className);
+    group.m_opacity = record.opacity;
+    group.m_visible = record.visible != 0;
+    group.m_offset = { record.offset[0], record.offset[1] };
+    group.m_parallaxFactor = { record.parallaxFactor[0], record.parallaxFactor[1] };
+    group.m_tintColour = readColour(record.tintColour);
+    group.m_size = { record.size[0], record.size[1] };
+    group.m_colour = readColour(record.colour);
+    group.m_drawOrder = static_cast<ObjectGroup::DrawOrder>(record.drawOrder);
+    group.m_objects = readObjects(record.objects);
+    group.m_properties = readProperties(record.groupProperties);
+}
+
+std::vector<Tileset> MapCache::readTilesets(Range range)
+{
+    std::vector<Tileset> tilesets;
+    const auto* records = this->records<TilesetRecord>(Tilesets, range);
+    if (!records)
+    {
+        return tilesets;
+    }
+
+    tilesets.reserve(range.count);
+    for (auto i = 0u; i < range.count; ++i)
+    {
+        const auto& record = records[i];
+        tilesets.emplace_back(readString(record.workingDirectory));
+        auto& tileset = tilesets.back();
+
+        tileset.m_source = readString(record.source);
+        tileset.m_name = readString(record.name);
+        tileset.m_class = readString(record.className);
+        tileset.m_imagePath = readString(record.imagePath);
+        tileset.m_firstGID = record.firstGID;
+        tileset.m_tileSize = { record.tileSize[0], record.tileSize[1] };
+        tileset.m_spacing = record.spacing;
+        tileset.m_margin = record.margin;
+        tileset.m_tileCount = record.tileCount;
+        tileset.m_columnCount = record.columnCount;
+        tileset.m_objectAlignment = static_cast<Tileset::ObjectAlignment>(record.objectAlignment);
+        tileset.m_tileOffset = { record.tileOffset[0], record.tileOffset[1] };
+        tileset.m_imageSize = { record.imageSize[0], record.imageSize[1] };
+        tileset.m_transparencyColour = readColour(record.transparencyColour);
+        tileset.m_hasTransparency = record.hasTransparency != 0;
+        tileset.m_properties = readProperties(record.properties);
+
+        const auto* terrains = this->records<TerrainRecord>(Terrains, record.terrains);
+        if (terrains)
+        {
+            tileset.m_terrainTypes.resize(record.terrains.count);
+            for (auto j = 0u; j < record.terrains.count; ++j)
+            {
+                auto& terrain = tileset.m_terrainTypes[j];
+                terrain.name = readString(terrains[j].name);
+                terrain.tileID = terrains[j].tileID;
+                terrain.properties = readProperties(terrains[j].properties);
+            }
+        }
+
+        const auto* indices = this->records<std::uint32_t>(TileIndices, record.tileIndices);
+        if (indices)
+        {
+            tileset.m_tileIndex.assign(indices, indices + record.tileIndices.count);
+        }
+
+        const auto* tiles = this->records<TilesetTileRecord>(TilesetTiles, record.tiles);
+        if (!tiles)
+        {
+            continue;
+        }
+
+        tileset.m_tiles.resize(record.tiles.count);
+        for (auto j = 0u; j < record.tiles.count; ++j)
+        {
+            const auto& tileRecord = tiles[j];
+            auto& tile = tileset.m_tiles[j];
+            tile.ID = tileRecord.id;
+            for (auto k = 0u; k < tile.terrainIndices.size(); ++k)
+            {
+                tile.terrainIndices[k] = tileRecord.terrainIndices[k];
+            }
+            tile.probability = tileRecord.probability;
+
+            const auto* frames = this->records<FrameRecord>(Frames, tileRecord.frames);
+            if (frames)
+            {
+                tile.animation.frames.resize(tileRecord.frames.count);
+                for (auto k = 0u; k < tileRecord.frames.count; ++k)
+                {
+                    tile.animation.frames[k].tileID = frames[k].tileID;
+                    tile.animation.frames[k].duration = frames[k].duration;
+                }
+            }
+
+            tile.properties = readProperties(tileRecord.properties);
+
+            if (tileRecord.objectGroup != NoIndex)
+            {
+                const auto* group = this->records<LayerRecord>(Layers, { tileRecord.objectGroup, 1 });
+                if (group)
+                {
+                    readObjectGroup(*group, tile.objectGroup);
+                }
+            }
+
+            tile.imagePath = readString(tileRecord.imagePath);
+            tile.className = readString(tileRecord.className);
+            tile.imageSize = { tileRecord.imageSize[0], tileRecord.imageSize[1] };
+            tile.imagePosition = { tileRecord.imagePosition[0], tileRecord.imagePosition[1] };
+        }
+    }
+    return tilesets;
+}
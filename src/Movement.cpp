@@ -0,0 +1,63 @@
+#include "Movement.h"
+#include "CollisionGrid.h"
+#include <algorithm>
+#include <cmath>
+
+sf::Vector2f movementVelocity(sf::Uint8 buttons) {
+  sf::Vector2f velocity(0.0f, 0.0f);
+  if (buttons & INPUT_UP) {
+    velocity.y -= PLAYER_SPEED;
+  }
+  if (buttons & INPUT_DOWN) {
+    velocity.y += PLAYER_SPEED;
+  }
+  if (buttons & INPUT_LEFT) {
+    velocity.x -= PLAYER_SPEED;
+  }
+  if (buttons & INPUT_RIGHT) {
+    velocity.x += PLAYER_SPEED;
+  }
+  return velocity;
+}
+
+sf::Vector2f stepMovement(const sf::Vector2f& position, sf::Uint8 buttons, float dt) {
+  // std::max passes NaN straight through, so it has to be caught first.
+  if (!std::isfinite(dt)) {
+    return position;
+  }
+  return position + movementVelocity(buttons) * std::min(std::max(dt, 0.0f), MAX_INPUT_DT);
+}
+
+sf::Vector2f resolveCollision(const sf::Vector2f& position, const sf::Vector2f& size,
+                              const sf::Vector2f& tilePosition, const sf::Vector2f& tileSize) {
+  sf::Vector2f center = position + sf::Vector2f(size.x / 2, size.y / 2);
+  sf::Vector2f tileCenter = tilePosition + sf::Vector2f(tileSize.x / 2, tileSize.y / 2);
+
+  float deltaX = center.x - tileCenter.x;
+  float deltaY = center.y - tileCenter.y;
+
+  sf::Vector2f resolved = position;
+  if (std::abs(deltaX) > std::abs(deltaY)) {
+    resolved.x = deltaX > 0 ? tilePosition.x + tileSize.x : tilePosition.x - size.x;
+  } else {
+    resolved.y = deltaY > 0 ? tilePosition.y + tileSize.y : tilePosition.y - size.y;
+  }
+  return resolved;
+}
+
+sf::Vector2f simulateMovement(const CollisionGrid& grid, const sf::Vector2f& position, sf::Uint8 buttons, float dt) {
+  sf::Vector2f moved = stepMovement(position, buttons, dt);
+
+  // Off the map there are no cells to collide with, so keep the box on it.
+  sf::Vector2f worldSize(grid.getColumns() * grid.getCellSize().x, grid.getRows() * grid.getCellSize().y);
+  if (worldSize.x > 0.0f && worldSize.y > 0.0f) {
+    moved.x = std::min(std::max(moved.x, 0.0f), std::max(worldSize.x - PLAYER_SIZE.x, 0.0f));
+    moved.y = std::min(std::max(moved.y, 0.0f), std::max(worldSize.y - PLAYER_SIZE.y, 0.0f));
+  }
+
+  sf::Vector2f tilePosition;
+  if (grid.findOverlap(moved, PLAYER_SIZE, tilePosition)) {
+    moved = resolveCollision(moved, PLAYER_SIZE, tilePosition, grid.getCellSize());
+  }
+  return moved;
+}
@@ -0,0 +1,47 @@
+#ifndef MOVEMENT_H
+#define MOVEMENT_H
+
+#include <SFML/Config.hpp>
+#include <SFML/System/Vector2.hpp>
+
+class CollisionGrid;
+
+// The movement rules shared by the client, which predicts its own player,
+// and the server, which replays the same inputs authoritatively. Nothing
+// here touches graphics, so the dedicated server links it as well.
+
+enum InputButton {
+  INPUT_UP = 1 << 0,
+  INPUT_DOWN = 1 << 1,
+  INPUT_LEFT = 1 << 2,
+  INPUT_RIGHT = 1 << 3
+};
+
+// One frame of input: the buttons held and how long the frame lasted.
+// Sequence numbers start at 1 and increase by one per frame.
+struct InputCommand {
+  sf::Uint32 sequence;
+  sf::Uint8 buttons;
+  float dt;
+};
+
+const float PLAYER_SPEED = 100.0f;
+// Longer frames are clamped so a client cannot claim a huge dt and jump.
+const float MAX_INPUT_DT = 0.25f;
+// The player's collision box: the 192x256 sprite frames drawn at half scale.
+const sf::Vector2f PLAYER_SIZE(96.0f, 128.0f);
+
+sf::Vector2f movementVelocity(sf::Uint8 buttons);
+// Free movement, ignoring the map.
+sf::Vector2f stepMovement(const sf::Vector2f& position, sf::Uint8 buttons, float dt);
+
+// Pushes a box at `position` out of the tile it overlaps, along whichever
+// axis the two centres are further apart on.
+sf::Vector2f resolveCollision(const sf::Vector2f& position, const sf::Vector2f& size,
+                              const sf::Vector2f& tilePosition, const sf::Vector2f& tileSize);
+
+// One frame for the player: step, keep the box on the map, then push it out
+// of the first blocking cell it ended up in.
+sf::Vector2f simulateMovement(const CollisionGrid& grid, const sf::Vector2f& position, sf::Uint8 buttons, float dt);
+
+#endif // MOVEMENT_H
@@ -0,0 +1,65 @@
+#include "NetworkSimulator.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+  float readEnvironment(const char* name) {
+    const char* value = std::getenv(name);
+    return value ? static_cast<float>(std::atof(value)) : 0.0f;
+  }
+}
+
+NetworkSimulator::NetworkSimulator() : random(std::random_device()()) {
+  float lossPercent = readEnvironment("SFMLGAME_SIM_LOSS");
+  float latencyMs = readEnvironment("SFMLGAME_SIM_LATENCY_MS");
+  float jitterMs = readEnvironment("SFMLGAME_SIM_JITTER_MS");
+  if (lossPercent > 0.0f || latencyMs > 0.0f || jitterMs > 0.0f) {
+    configure(lossPercent / 100.0f, sf::milliseconds(static_cast<sf::Int32>(latencyMs)),
+              sf::milliseconds(static_cast<sf::Int32>(jitterMs)));
+    std::cout << "Simulating " << lossPercent << "% loss, " << latencyMs << " ms latency, "
+              << jitterMs << " ms jitter on outgoing datagrams" << std::endl;
+  }
+}
+
+void NetworkSimulator::configure(float loss, sf::Time latency, sf::Time jitter) {
+  this->loss = loss;
+  this->latency = latency;
+  this->jitter = jitter;
+  enabled = loss > 0.0f || latency > sf::Time::Zero || jitter > sf::Time::Zero;
+}
+
+sf::Socket::Status NetworkSimulator::send(sf::UdpSocket& socket, sf::Packet& packet, const sf::IpAddress& address,
+                                          unsigned short port) {
+  if (!enabled) {
+    return socket.send(packet, address, port);
+  }
+
+  // Report success for dropped datagrams too; the sender never finds out.
+  if (std::uniform_real_distribution<float>(0.0f, 1.0f)(random) < loss) {
+    return sf::Socket::Done;
+  }
+
+  Datagram datagram;
+  sf::Int64 extra = jitter > sf::Time::Zero
+                        ? std::uniform_int_distribution<sf::Int64>(0, jitter.asMicroseconds())(random)
+                        : 0;
+  datagram.due = clock.getElapsedTime() + latency + sf::microseconds(extra);
+  const char* data = static_cast<const char*>(packet.getData());
+  datagram.data.assign(data, data + packet.getDataSize());
+  datagram.address = address;
+  datagram.port = port;
+  delayed.push_back(std::move(datagram));
+  return sf::Socket::Done;
+}
+
+void NetworkSimulator::flush(sf::UdpSocket& socket) {
+  sf::Time now = clock.getElapsedTime();
+  for (auto it = delayed.begin(); it != delayed.end();) {
+    if (it->due > now) {
+      ++it;
+      continue;
+    }
+    socket.send(it->data.data(), it->data.size(), it->address, it->port);
+    it = delayed.erase(it);
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef NETWORK_SIMULATOR_H
+#define NETWORK_SIMULATOR_H
+
+#include <SFML/Network.hpp>
+#include <random>
+#include <vector>
+
+// Sends datagrams through a pretend bad link, for testing on loopback.
+// Outgoing datagrams are dropped with probability `loss` and otherwise held
+// back for `latency` plus up to `jitter`, so they can also arrive out of
+// order. Configured from the environment:
+//
+//   SFMLGAME_SIM_LOSS        percentage of datagrams to drop (0-100)
+//   SFMLGAME_SIM_LATENCY_MS  one-way delay added to each datagram
+//   SFMLGAME_SIM_JITTER_MS   extra random delay on top of that
+//
+// With none of them set every send goes straight to the socket.
+class NetworkSimulator {
+ public:
+  NetworkSimulator();
+
+  void configure(float loss, sf::Time latency, sf::Time jitter);
+  bool isEnabled() const { return enabled; }
+  bool hasDelayed() const { return !delayed.empty(); }
+
+  sf::Socket::Status send(sf::UdpSocket& socket, sf::Packet& packet, const sf::IpAddress& address,
+                          unsigned short port);
+  // Sends the held-back datagrams whose time has come.
+  void flush(sf::UdpSocket& socket);
+
+ private:
+  struct Datagram {
+    sf::Time due;
+    std::vector<char> data;
+    sf::IpAddress address;
+    unsigned short port;
+  };
+
+  bool enabled = false;
+  float loss = 0.0f;
+  sf::Time latency;
+  sf::Time jitter;
+  std::vector<Datagram> delayed;
+  sf::Clock clock;
+  std::mt19937 random;
+};
+
+#endif // NETWORK_SIMULATOR_H
@@ -2,62 +2,51 @@
 #include <iostream>
 
 Player::Player(int id, const sf::Vector2f& startPosition)
-  : id(id), position(startPosition), speed(100.0f), frameTime(0.0f), currentFrame(0), animationSpeed(0.2f) {
+  : id(id), position(startPosition), frameTime(0.0f), currentFrame(0), animationSpeed(0.2f) {
 
-  loadFramesFromXML("Data/Images/Spritesheet.xml");
+  ResourceCache& cache = ResourceCache::shared();
+  atlas = cache.getAtlas("Data/Images/Spritesheet.xml");
+  playerTexture = cache.getTexture("Data/Images/Spritesheet.png");
+  frames = &atlas->getAnimation("walk");
 
-  if (!playerTexture.loadFromFile("Data/Images/Spritesheet.png")) {
-    std::cerr << "Failed to load player sprites." << std::endl;
-  }
-
-  playerSprite.setTexture(playerTexture);
-  if (!frames.empty()) {
-    playerSprite.setTextureRect(frames[0].rect);
+  playerSprite.setTexture(*playerTexture);
+  if (!frames->empty()) {
+    playerSprite.setTextureRect((*frames)[0]);
   }
   playerSprite.setPosition(position);
   playerSprite.setScale(0.5f, 0.5f);
 }
 
-void Player::loadFramesFromXML(const std::string& xmlFile) {
-  tinyxml2::XMLDocument doc;
-  if (doc.LoadFile(xmlFile.c_str()) != tinyxml2::XML_SUCCESS) {
-    std::cerr << "Failed to load XML file: " << xmlFile << std::endl;
-    return;
-  }
-
-  tinyxml2::XMLElement* root = doc.FirstChildElement("TextureAtlas");
-  for (tinyxml2::XMLElement* elem = root->FirstChildElement("SubTexture"); elem; elem = elem->NextSiblingElement("SubTexture")) {
-    std::string name = elem->Attribute("name");
-
-    if (name.find("walk") != std::string::npos) {
-      Frame frame;
-      frame.rect = sf::IntRect(
-        elem->IntAttribute("x"),
-        elem->IntAttribute("y"),
-        elem->IntAttribute("width"),
-        elem->IntAttribute("height")
-      );
-      frames.push_back(frame);
-    }
-  }
-}
-void Player::handleInput(const sf::RenderWindow& window) {
-  velocity = sf::Vector2f(0.0f, 0.0f);
+sf::Uint8 Player::sampleInput(const sf::RenderWindow& window) {
+  sf::Uint8 buttons = 0;
 
   if (window.hasFocus()) {
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) {
-      velocity.y -= speed;
+      buttons |= INPUT_UP;
     }
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) {
-      velocity.y += speed;
+      buttons |= INPUT_DOWN;
     }
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) {
-      velocity.x -= speed;
+      buttons |= INPUT_LEFT;
     }
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) {
-      velocity.x += speed;
+      buttons |= INPUT_RIGHT;
     }
   }
+  return buttons;
+}
+
+void Player::applyInput(sf::Uint8 buttons) {
+  velocity = movementVelocity(buttons);
+}
+
+void Player::handleInput(const sf::RenderWindow& window) {
+  applyInput(sampleInput(window));
+}
+
+void Player::setRenderPosition(const sf::Vector2f& renderPosition) {
+  playerSprite.setPosition(renderPosition);
 }
 
 sf::Vector2f Player::getSpriteSize() const
@@ -67,54 +56,24 @@ sf::Vector2f Player::getSpriteSize() const
     playerSprite.getGlobalBounds().height);
 }
 void Player::update(float deltaTime) {
-  position += velocity * deltaTime;
   playerSprite.setPosition(position);
 
   if (velocity.x != 0.0f || velocity.y != 0.0f) {
     frameTime += deltaTime;
-    if (frameTime >= animationSpeed) {
+    if (frameTime >= animationSpeed && !frames->empty()) {
       frameTime = 0.f;
-      currentFrame = (currentFrame + 1) % frames.size();
-      playerSprite.setTextureRect(frames[currentFrame].rect);
+      currentFrame = (currentFrame + 1) % frames->size();
+      playerSprite.setTextureRect((*frames)[currentFrame]);
     }
-  } else {
+  } else if (!frames->empty()) {
 
     currentFrame = 0;
-    playerSprite.setTextureRect(frames[currentFrame].rect);
+    playerSprite.setTextureRect((*frames)[currentFrame]);
   }
 
   updateChat(deltaTime);
 }
 
-void Player::handleCollision(const sf::Vector2f& tilePosition, const sf::Vector2f& tileSize) {
-
-  sf::Vector2f playerSize = sf::Vector2f(playerSprite.getGlobalBounds().width, playerSprite.getGlobalBounds().height);
-
-  sf::Vector2f playerCenter = position + sf::Vector2f(playerSize.x / 2, playerSize.y / 2);
-  sf::Vector2f tileCenter = tilePosition + sf::Vector2f(tileSize.x / 2, tileSize.y / 2);
-
-  float deltaX = playerCenter.x - tileCenter.x;
-  float deltaY = playerCenter.y - tileCenter.y;
-
-  if (std::abs(deltaX) > std::abs(deltaY)) {
-    if (deltaX > 0) {
-
-      position.x = tilePosition.x + tileSize.x;
-    } else {
-
-      position.x = tilePosition.x - playerSize.x;
-    }
-  } else {
-    if (deltaY > 0) {
-
-      position.y = tilePosition.y + tileSize.y;
-    } else {
-
-      position.y = tilePosition.y - playerSize.y;
-    }
-  }
-}
-
 void Player::draw(sf::RenderWindow& window, const sf::Font& font) const {
   window.draw(playerSprite);
 
@@ -5,12 +5,19 @@
 #include <SFML/Network.hpp>
 #include <vector>
 #include <string>
-#include "tinyxml2.h"
+#include <memory>
+#include "Movement.h"
+#include "ResourceCache.h"
 
 class Player {
  public:
   Player(int id, const sf::Vector2f& startPosition);
+  // Reads WASD into InputButton bits; nothing while the window is unfocused.
+  static sf::Uint8 sampleInput(const sf::RenderWindow& window);
+  void applyInput(sf::Uint8 buttons);
   void handleInput(const sf::RenderWindow& window);
+  // Animates and ages chat bubbles. Movement itself is simulateMovement's
+  // job; the game moves the local player with it and setPosition()s here.
   void update(float deltaTime);
   void draw(sf::RenderWindow& window, const sf::Font& font) const;
   void addChatMessage(const std::string& message, float duration);
@@ -18,8 +25,10 @@ class Player {
   std::vector<std::string> getChatMessages() const;
   sf::Vector2f getPosition() const;
   void setPosition(const sf::Vector2f& newPosition);
+  // Where the sprite is drawn, which can trail the simulated position when
+  // the game draws between two steps. update() snaps it back.
+  void setRenderPosition(const sf::Vector2f& renderPosition);
   int getId() const;
-  void handleCollision(const sf::Vector2f& tilePosition, const sf::Vector2f& tileSize);
   sf::Vector2f getSpriteSize() const;
 
  private:
@@ -28,24 +37,19 @@ class Player {
     float displayTime;
   };
 
-  struct Frame {
-    sf::IntRect rect;
-    std::string name;
-  };
-
   int id;
   sf::Vector2f position;
   sf::Vector2f velocity;
-  float speed;
   std::vector<ChatMessage> chatMessages;
-  sf::Texture playerTexture;
+  // Shared with every other Player through ResourceCache; frames points into
+  // the atlas, which the handle keeps alive.
+  std::shared_ptr<const sf::Texture> playerTexture;
+  std::shared_ptr<const TextureAtlas> atlas;
+  const std::vector<sf::IntRect>* frames;
   sf::Sprite playerSprite;
-  std::vector<Frame> frames;
   float frameTime;
   int currentFrame;
   float animationSpeed;
-
-  void loadFramesFromXML(const std::string& xmlFile);
 };
 
 #endif // PLAYER_H
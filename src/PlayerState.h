@@ -0,0 +1,13 @@
+#ifndef PLAYER_STATE_H
+#define PLAYER_STATE_H
+
+#include <SFML/System/Vector2.hpp>
+
+// What the server knows about a player. Unlike Player it carries no
+// textures or sprites, so the server can be built without sfml-graphics.
+struct PlayerState {
+  int id;
+  sf::Vector2f position;
+};
+
+#endif // PLAYER_STATE_H
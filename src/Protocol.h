@@ -0,0 +1,76 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <SFML/Config.hpp>
+
+// Values shared by the client and the server. Every packet starts with an
+// int packet type so both sides can dispatch on it.
+const unsigned short SERVER_PORT = 53000;
+
+// Highest wire format this build understands. Version 0 is the original
+// int/float packets; version 1 adds PACKET_HELLO and compact snapshots;
+// version 2 replaces those with acknowledged delta snapshots; version 3
+// moves movement and snapshots onto UDP, and sends inputs rather than
+// positions once the UDP endpoint is up.
+const sf::Uint8 PROTOCOL_VERSION = 3;
+
+const char* const MAP_PATH = "Data/Map/Map.tmx";
+// Binary copy of a map, written next to it the first time it's loaded. See
+// tmx::Map::saveCache().
+const char* const MAP_CACHE_SUFFIX = ".cache";
+// The map is drawn scaled up by this much, so world coordinates (player
+// positions) are tile pixels times MAP_SCALE.
+const float MAP_SCALE = 3.5f;
+
+enum PacketType {
+  PACKET_POSITION = 0,
+  PACKET_CHAT = 1,
+  // int count, then count x (int id, float x, float y)
+  PACKET_SNAPSHOT = 2,
+  // see SnapshotCodec
+  PACKET_SNAPSHOT_COMPACT = 3,
+  // client -> server: Uint8 highest protocol version the client supports
+  PACKET_HELLO = 4,
+  // see SnapshotCodec
+  PACKET_SNAPSHOT_DELTA = 5,
+  // client -> server: varint sequence of the last delta it decoded
+  PACKET_SNAPSHOT_ACK = 6,
+  // UDP, client -> server: int player id, Uint32 token from the handshake.
+  // The server echoes an empty one back once the endpoint is registered.
+  PACKET_UDP_HELLO = 7,
+  // UDP, client -> server: Uint32 newest input sequence, Uint8 count, then
+  // `count` commands oldest first, each Uint8 buttons and float dt. Every
+  // datagram repeats the inputs the server has not acknowledged yet.
+  PACKET_INPUT = 8,
+  // UDP, both ways: Uint8 channel, Uint16 sequence, then a whole packet of
+  // one of the other types; see ReliableEndpoint
+  PACKET_RELIABLE = 9,
+  // UDP, both ways: Uint8 channel, Uint16 newest sequence, Uint32 ack bits
+  PACKET_RELIABLE_ACK = 10,
+  // server -> client: int player id
+  PACKET_PLAYER_JOINED = 11,
+  PACKET_PLAYER_LEFT = 12,
+  // UDP, server -> client: Uint32 last input sequence applied, float x,
+  // float y of the client's own player after applying it
+  PACKET_INPUT_ACK = 13
+};
+
+// Reliable channels are ordered independently, so a resent chat line never
+// holds up a join or leave notice.
+enum ReliableChannel {
+  CHANNEL_CHAT = 0,
+  CHANNEL_EVENTS = 1,
+  CHANNEL_COUNT
+};
+
+// The handshake is the player ID (int) on its own for version 0. Newer
+// servers follow it with Uint8 protocol version and the world size as two
+// floats, then (version 3) a Uint32 token that ties the client's UDP
+// endpoint to this connection. Old clients simply never read past the ID.
+//
+// Over UDP each datagram is one sf::Packet's payload. Once the client's
+// endpoint is registered, inputs and delta snapshots use it unreliably,
+// and chat and join/leave notices use it through PACKET_RELIABLE. Only the
+// player-ID handshake stays on TCP.
+
+#endif // PROTOCOL_H
@@ -0,0 +1,145 @@
+#include "ReliableEndpoint.h"
+
+namespace {
+  const sf::Time RESEND_TIMEOUT = sf::milliseconds(200);
+  // int packet type, Uint8 channel, Uint16 sequence
+  const std::size_t HEADER_SIZE = sizeof(sf::Int32) + sizeof(sf::Uint8) + sizeof(sf::Uint16);
+
+  // Whether `a` comes after `b`, allowing for the sequence wrapping around.
+  bool sequenceGreater(sf::Uint16 a, sf::Uint16 b) {
+    return a != b && static_cast<sf::Uint16>(a - b) < 0x8000;
+  }
+}
+
+void ReliableEndpoint::queue(sf::Uint8 channel, const sf::Packet& message) {
+  if (channel >= CHANNEL_COUNT) {
+    return;
+  }
+
+  SendChannel& send = sendChannels[channel];
+  Outgoing outgoing;
+  outgoing.sequence = send.nextSequence++;
+  const char* data = static_cast<const char*>(message.getData());
+  outgoing.data.assign(data, data + message.getDataSize());
+  send.pending.push_back(std::move(outgoing));
+}
+
+void ReliableEndpoint::collectOutgoing(sf::Time now, std::vector<sf::Packet>& datagrams) {
+  for (sf::Uint8 channel = 0; channel < CHANNEL_COUNT; ++channel) {
+    ReceiveChannel& receive = receiveChannels[channel];
+    if (receive.ackPending) {
+      sf::Packet ack;
+      ack << PACKET_RELIABLE_ACK << channel << receive.latestReceived << receive.ackBits;
+      datagrams.push_back(ack);
+      receive.ackPending = false;
+    }
+
+    SendChannel& send = sendChannels[channel];
+    if (send.pending.empty()) {
+      continue;
+    }
+
+    sf::Uint16 windowStart = send.pending.front().sequence;
+    for (auto& outgoing : send.pending) {
+      if (static_cast<sf::Uint16>(outgoing.sequence - windowStart) >= WINDOW) {
+        break;
+      }
+      if (outgoing.acked || (outgoing.sent && now - outgoing.lastSent < RESEND_TIMEOUT)) {
+        continue;
+      }
+
+      if (outgoing.sent) {
+        ++resends;
+      }
+      sf::Packet datagram;
+      datagram << PACKET_RELIABLE << channel << outgoing.sequence;
+      datagram.append(outgoing.data.data(), outgoing.data.size());
+      datagrams.push_back(datagram);
+      outgoing.sent = true;
+      outgoing.lastSent = now;
+    }
+  }
+}
+
+void ReliableEndpoint::receive(sf::Packet& datagram, std::vector<sf::Packet>& delivered) {
+  sf::Uint8 channel;
+  sf::Uint16 sequence;
+  if (!(datagram >> channel >> sequence) || channel >= CHANNEL_COUNT) {
+    return;
+  }
+
+  ReceiveChannel& receive = receiveChannels[channel];
+  recordReceived(receive, sequence);
+
+  // Already delivered (our ack was lost), or further ahead than the sender
+  // is allowed to get.
+  if (sequenceGreater(receive.nextExpected, sequence) ||
+      static_cast<sf::Uint16>(sequence - receive.nextExpected) >= WINDOW) {
+    return;
+  }
+
+  Slot& slot = receive.slots[sequence % WINDOW];
+  if (!slot.present) {
+    const char* data = static_cast<const char*>(datagram.getData());
+    slot.data.assign(data + HEADER_SIZE, data + datagram.getDataSize());
+    slot.sequence = sequence;
+    slot.present = true;
+  }
+
+  while (true) {
+    Slot& next = receive.slots[receive.nextExpected % WINDOW];
+    if (!next.present || next.sequence != receive.nextExpected) {
+      break;
+    }
+
+    sf::Packet message;
+    message.append(next.data.data(), next.data.size());
+    delivered.push_back(message);
+    next.present = false;
+    ++receive.nextExpected;
+  }
+}
+
+void ReliableEndpoint::receiveAck(sf::Packet& datagram) {
+  sf::Uint8 channel;
+  sf::Uint16 ack;
+  sf::Uint32 ackBits;
+  if (!(datagram >> channel >> ack >> ackBits) || channel >= CHANNEL_COUNT) {
+    return;
+  }
+
+  SendChannel& send = sendChannels[channel];
+  for (auto& outgoing : send.pending) {
+    if (!outgoing.sent || sequenceGreater(outgoing.sequence, ack)) {
+      continue;
+    }
+    sf::Uint16 distance = static_cast<sf::Uint16>(ack - outgoing.sequence);
+    if (distance == 0 || (distance <= 32 && (ackBits & (1u << (distance - 1))))) {
+      outgoing.acked = true;
+    }
+  }
+
+  while (!send.pending.empty() && send.pending.front().acked) {
+    send.pending.pop_front();
+  }
+}
+
+// Bit i of ackBits stands for latestReceived - 1 - i.
+void ReliableEndpoint::recordReceived(ReceiveChannel& channel, sf::Uint16 sequence) {
+  channel.ackPending = true;
+
+  if (!channel.hasReceived) {
+    channel.hasReceived = true;
+    channel.latestReceived = sequence;
+    channel.ackBits = 0;
+  } else if (sequenceGreater(sequence, channel.latestReceived)) {
+    sf::Uint16 shift = static_cast<sf::Uint16>(sequence - channel.latestReceived);
+    channel.ackBits = shift > 32 ? 0 : ((shift == 32 ? 0 : channel.ackBits << shift) | (1u << (shift - 1)));
+    channel.latestReceived = sequence;
+  } else {
+    sf::Uint16 distance = static_cast<sf::Uint16>(channel.latestReceived - sequence);
+    if (distance >= 1 && distance <= 32) {
+      channel.ackBits |= 1u << (distance - 1);
+    }
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef RELIABLE_ENDPOINT_H
+#define RELIABLE_ENDPOINT_H
+
+#include <SFML/Network.hpp>
+#include <array>
+#include <deque>
+#include <vector>
+#include "Protocol.h"
+
+// Reliable, ordered delivery to one peer over UDP. Each channel numbers its
+// messages with a 16-bit sequence and sends every message in its own
+// PACKET_RELIABLE datagram; the peer answers with PACKET_RELIABLE_ACK
+// carrying the newest sequence it has seen plus a bitfield for the 32 before
+// it, so one ack covers any that were lost in between. Unacknowledged
+// messages are resent after RESEND_TIMEOUT, and the receiver holds back
+// anything that arrives early until the gap is filled. At most WINDOW
+// messages per channel are in flight, which keeps both sides inside the
+// range the ack bitfield can describe.
+class ReliableEndpoint {
+ public:
+  static const sf::Uint16 WINDOW = 32;
+
+  // `message` is a complete packet, type first, as it would go over TCP.
+  void queue(sf::Uint8 channel, const sf::Packet& message);
+
+  // Appends the datagrams that should go out now: acks for anything received
+  // since the last call, new messages, and messages due for a resend.
+  void collectOutgoing(sf::Time now, std::vector<sf::Packet>& datagrams);
+
+  // Both take the datagram with its packet type already read. Messages that
+  // are now in order are appended to `delivered`.
+  void receive(sf::Packet& datagram, std::vector<sf::Packet>& delivered);
+  void receiveAck(sf::Packet& datagram);
+
+  unsigned int getResendCount() const { return resends; }
+
+ private:
+  struct Outgoing {
+    sf::Uint16 sequence = 0;
+    std::vector<char> data;
+    sf::Time lastSent;
+    bool sent = false;
+    bool acked = false;
+  };
+
+  struct SendChannel {
+    sf::Uint16 nextSequence = 0;
+    std::deque<Outgoing> pending;
+  };
+
+  struct Slot {
+    sf::Uint16 sequence = 0;
+    bool present = false;
+    std::vector<char> data;
+  };
+
+  struct ReceiveChannel {
+    sf::Uint16 nextExpected = 0;
+    std::array<Slot, WINDOW> slots;
+    bool hasReceived = false;
+    sf::Uint16 latestReceived = 0;
+    sf::Uint32 ackBits = 0;
+    bool ackPending = false;
+  };
+
+  static void recordReceived(ReceiveChannel& channel, sf::Uint16 sequence);
+
+  std::array<SendChannel, CHANNEL_COUNT> sendChannels;
+  std::array<ReceiveChannel, CHANNEL_COUNT> receiveChannels;
+  unsigned int resends = 0;
+};
+
+#endif // RELIABLE_ENDPOINT_H
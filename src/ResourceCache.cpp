@@ -0,0 +1,75 @@
+#include "ResourceCache.h"
+#include "tinyxml2.h"
+#include <cctype>
+#include <iostream>
+
+bool TextureAtlas::loadFromFile(const std::string& xmlFile) {
+  tinyxml2::XMLDocument doc;
+  if (doc.LoadFile(xmlFile.c_str()) != tinyxml2::XML_SUCCESS) {
+    return false;
+  }
+
+  tinyxml2::XMLElement* root = doc.FirstChildElement("TextureAtlas");
+  if (!root) {
+    return false;
+  }
+
+  for (tinyxml2::XMLElement* elem = root->FirstChildElement("SubTexture"); elem; elem = elem->NextSiblingElement("SubTexture")) {
+    const char* attribute = elem->Attribute("name");
+    std::string name = attribute ? attribute : "";
+    while (!name.empty() && std::isdigit(static_cast<unsigned char>(name.back()))) {
+      name.pop_back();
+    }
+
+    animations[name].emplace_back(
+      elem->IntAttribute("x"),
+      elem->IntAttribute("y"),
+      elem->IntAttribute("width"),
+      elem->IntAttribute("height")
+    );
+  }
+  return true;
+}
+
+const std::vector<sf::IntRect>& TextureAtlas::getAnimation(const std::string& name) const {
+  static const std::vector<sf::IntRect> empty;
+  auto it = animations.find(name);
+  return it != animations.end() ? it->second : empty;
+}
+
+ResourceCache& ResourceCache::shared() {
+  static ResourceCache cache;
+  return cache;
+}
+
+template <typename T>
+std::shared_ptr<const T> ResourceCache::get(std::unordered_map<std::string, std::weak_ptr<const T>>& entries,
+                                            const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (auto existing = entries[path].lock()) {
+    return existing;
+  }
+
+  auto resource = std::make_shared<T>();
+  if (!resource->loadFromFile(path)) {
+    std::cerr << "Failed to load resource: " << path << std::endl;
+  }
+
+  // Failed loads are cached as well, so a missing file is reported once per
+  // lifetime instead of once per caller.
+  entries[path] = resource;
+  return resource;
+}
+
+std::shared_ptr<const sf::Texture> ResourceCache::getTexture(const std::string& path) {
+  return get(textures, path);
+}
+
+std::shared_ptr<const sf::Font> ResourceCache::getFont(const std::string& path) {
+  return get(fonts, path);
+}
+
+std::shared_ptr<const TextureAtlas> ResourceCache::getAtlas(const std::string& path) {
+  return get(atlases, path);
+}
@@ -0,0 +1,45 @@
+#ifndef RESOURCE_CACHE_H
+#define RESOURCE_CACHE_H
+
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Sub-rectangles parsed from a TextureAtlas XML file. Numbered frames such as
+// walk0..walk7 are grouped into one animation called "walk".
+class TextureAtlas {
+ public:
+  bool loadFromFile(const std::string& xmlFile);
+  const std::vector<sf::IntRect>& getAnimation(const std::string& name) const;
+
+ private:
+  std::unordered_map<std::string, std::vector<sf::IntRect>> animations;
+};
+
+// Loads each texture, font and atlas from disk once and hands out shared
+// handles to it. The cache only keeps weak references, so a resource is
+// freed when the last handle goes away and reloaded the next time it is
+// asked for.
+class ResourceCache {
+ public:
+  static ResourceCache& shared();
+
+  std::shared_ptr<const sf::Texture> getTexture(const std::string& path);
+  std::shared_ptr<const sf::Font> getFont(const std::string& path);
+  std::shared_ptr<const TextureAtlas> getAtlas(const std::string& path);
+
+ private:
+  template <typename T>
+  std::shared_ptr<const T> get(std::unordered_map<std::string, std::weak_ptr<const T>>& entries,
+                               const std::string& path);
+
+  std::mutex mutex;
+  std::unordered_map<std::string, std::weak_ptr<const sf::Texture>> textures;
+  std::unordered_map<std::string, std::weak_ptr<const sf::Font>> fonts;
+  std::unordered_map<std::string, std::weak_ptr<const TextureAtlas>> atlases;
+};
+
+#endif // RESOURCE_CACHE_H
@@ -1,119 +1,574 @@
 #include "Server.h"
+#include "Protocol.h"
+#include <tmxlite/Map.hpp>
 #include <iostream>
-#include <thread>
 #include <algorithm>
+#include <cmath>
 
-Server::Server() : listener(std::make_unique<sf::TcpListener>()), nextPlayerId(1) {
+namespace {
+  // How long the loop waits before retrying a flush that the socket could
+  // not take in one go.
+  const sf::Time WRITE_RETRY_INTERVAL = sf::milliseconds(5);
+  const sf::Time STATS_INTERVAL = sf::seconds(10.0f);
+  const unsigned int SPATIAL_CELL_TILES = 4;
+  // Furthest a reported position may be from the last accepted one. Clients
+  // report every 100 ms; this allows for a few of those arriving at once.
+  const float MAX_POSITION_STEP = PLAYER_SPEED * 0.5f;
+}
+
+Server::Server(unsigned int tickRate)
+  : listener(std::make_unique<sf::TcpListener>()), tokenGenerator(std::random_device()()), scheduler(tickRate) {
 
 }
 
 void Server::updatePlayerPosition(int playerId, sf::Vector2f newPosition) {
-  for (auto& player : players) {
-    if (player.getId() == playerId) {
-      player.setPosition(newPosition);
-      break;
+  PlayerState* player = players.find(playerId);
+  if (player) {
+    player->position = newPosition;
+    dirtyPlayers.insert(playerId);
+  }
+}
+
+bool Server::loadMap(const std::string& path) {
+  tmx::Map map;
+  const std::string cachePath = path + MAP_CACHE_SUFFIX;
+  if (!map.loadCache(cachePath, path)) {
+    // Decode tile layers on every core when the cache has to be rebuilt.
+    map.setLoadThreadCount(0);
+    if (!map.load(path)) {
+      std::cerr << "Failed to Load Map Data" << std::endl;
+      return false;
     }
+    map.saveCache(cachePath);
   }
-  broadcastPlayerPositions(nullptr);
+
+  collisionGrid.build(map, MAP_SCALE);
+  codec.setWorldSize(sf::Vector2f(collisionGrid.getColumns() * collisionGrid.getCellSize().x,
+                                  collisionGrid.getRows() * collisionGrid.getCellSize().y));
+  spatialGrid.reset(collisionGrid.getColumns(), collisionGrid.getRows(), collisionGrid.getCellSize(), SPATIAL_CELL_TILES);
+
+  std::cout << "Loaded map " << path << " (" << collisionGrid.getColumns() << "x" << collisionGrid.getRows() << ")" << std::endl;
+  return true;
 }
 
 void Server::init() {
-  if (listener->listen(53000) != sf::Socket::Done) {
-    std::cerr << "Error listening on port 53000\n";
+  if (listener->listen(SERVER_PORT) != sf::Socket::Done) {
+    std::cerr << "Error listening on port " << SERVER_PORT << "\n";
+  } else {
+    std::cout << "Listening on port " << SERVER_PORT << " at " << scheduler.getTickRate() << " ticks/s\n";
+  }
+  // accept() must never stall the tick loop; NotReady just means no one is waiting.
+  listener->setBlocking(false);
+  selector.add(*listener);
+
+  if (udpSocket.bind(SERVER_PORT) != sf::Socket::Done) {
+    std::cerr << "Error binding UDP port " << SERVER_PORT << ", clients will stay on TCP\n";
   } else {
-    std::cout << "Listening on port 53000\n";
+    udpSocket.setBlocking(false);
+    selector.add(udpSocket);
   }
 }
 
+// Single-threaded event loop: the selector wakes us when the listener has a
+// pending connection or a client socket has data, so one thread serves every
+// client instead of one blocked thread per socket. Packets only queue inputs;
+// the simulation itself advances on the scheduler's fixed tick.
 void Server::run() {
   while (true) {
-    sf::TcpSocket* cSock = new sf::TcpSocket();
-    if (listener->accept(*cSock) == sf::Socket::Done) {
-      std::cout << "Client connected, assigning ID: " << nextPlayerId << std::endl;
-
-      sf::Packet idPacket;
-      idPacket << nextPlayerId;
-      if (cSock->send(idPacket) != sf::Socket::Done) {
-        std::cerr << "Failed to send player ID to client." << std::endl;
-        delete cSock;
-        continue;
+    bool pendingWrites = simulator.hasDelayed() ||
+                         std::any_of(connections.begin(), connections.end(),
+                                     [](const std::unique_ptr<Connection>& c) { return c->hasPendingWrites(); });
+
+    sf::Time untilTick = scheduler.timeUntilNextTick();
+    sf::Time timeout = pendingWrites ? std::min(untilTick, WRITE_RETRY_INTERVAL) : untilTick;
+
+    // A zero timeout makes wait() block forever, so a tick that's already
+    // due still polls for a microsecond. Readiness is only read after a
+    // wait that actually ran; older flags are stale.
+    if (selector.wait(std::max(timeout, sf::microseconds(1)))) {
+      if (selector.isReady(*listener)) {
+        acceptConnection();
+      }
+      if (selector.isReady(udpSocket)) {
+        receiveDatagrams();
       }
 
-      connectedClients.push_back(cSock);
-      sf::Vector2f startingPosition(100.0f, 100.0f);
-      Player newPlayer(nextPlayerId++, startingPosition);
-      players.push_back(newPlayer);
+      for (std::size_t i = 0; i < connections.size(); ++i) {
+        Connection& connection = *connections[i];
+        if (connection.isOpen() && selector.isReady(connection.getSocket())) {
+          receiveFromConnection(connection);
+        }
+      }
+    }
 
-      std::thread clientThread(&Server::handleClient, this, cSock);
-      clientThread.detach();
-    } else {
-      delete cSock;
+    if (scheduler.isTickDue()) {
+      scheduler.beginTick();
+      tick();
+      scheduler.endTick();
+    }
+
+    if (statsClock.getElapsedTime() >= STATS_INTERVAL) {
+      reportTickStats();
     }
+
+    flushConnections();
+    simulator.flush(udpSocket);
+    removeClosedConnections();
   }
 }
 
-void Server::handleClient(sf::TcpSocket* cSocket) {
-  while (true) {
-    sf::Packet packet;
-    if (cSocket->receive(packet) == sf::Socket::Done) {
-      int packetType;
-      packet >> packetType;
-
-      if (packetType == 0) {
-        int receivedPlayerId;
-        sf::Vector2f position;
-        packet >> receivedPlayerId >> position.x >> position.y;
-        updatePlayerPosition(receivedPlayerId, position);
-        broadcastPlayerPositions(cSocket);
-      } else if (packetType == 1) {
-        int senderId;
-        std::string message;
-        packet >> senderId >> message;
-
-        if (!message.empty()) {
-          std::cout << "Received chat message from Player ID " << senderId << ": " << message << std::endl;
+void Server::acceptConnection() {
+  auto cSock = std::make_unique<sf::TcpSocket>();
+  if (listener->accept(*cSock) != sf::Socket::Done) {
+    return;
+  }
+
+  // The player's key in the entity table doubles as its ID on the wire.
+  sf::Vector2f startingPosition(100.0f, 100.0f);
+  int playerId = static_cast<int>(players.insert({0, startingPosition}));
+  players.find(playerId)->id = playerId;
+  dirtyPlayers.insert(playerId);
+
+  std::cout << "Client connected, assigning ID: " << playerId << std::endl;
+
+  auto connection = std::make_unique<Connection>(std::move(cSock));
+  connection->setPlayerId(playerId);
+  connection->setUdpToken(tokenGenerator());
+
+  sf::Packet idPacket;
+  idPacket << playerId << PROTOCOL_VERSION << codec.getWorldSize().x << codec.getWorldSize().y
+           << connection->getUdpToken();
+  connection->queuePacket(idPacket);
+
+  selector.add(connection->getSocket());
+  broadcastPlayerEvent(PACKET_PLAYER_JOINED, connection->getPlayerId());
+  connections.push_back(std::move(connection));
+}
+
+void Server::receiveFromConnection(Connection& connection) {
+  std::vector<sf::Packet> packets;
+  bool stillOpen = connection.receive(packets);
+
+  for (auto& packet : packets) {
+    handlePacket(connection, packet);
+  }
+
+  if (!stillOpen) {
+    std::cerr << "Client disconnected or encountered an error." << std::endl;
+  }
+}
+
+void Server::receiveDatagrams() {
+  sf::Packet packet;
+  sf::IpAddress address;
+  unsigned short port;
+  while (udpSocket.receive(packet, address, port) == sf::Socket::Done) {
+    handleDatagram(packet, address, port);
+    packet.clear();
+  }
+}
+
+void Server::handleDatagram(sf::Packet& packet, const sf::IpAddress& address, unsigned short port) {
+  int packetType;
+  if (!(packet >> packetType)) {
+    return;
+  }
+
+  if (packetType == PACKET_UDP_HELLO) {
+    int playerId;
+    sf::Uint32 token;
+    if (!(packet >> playerId >> token)) {
+      return;
+    }
+
+    for (auto& connection : connections) {
+      if (connection->getPlayerId() == playerId && connection->getUdpToken() == token) {
+        if (connection->hasUdpEndpoint()) {
+          udpEndpoints.erase({connection->getUdpAddress().toInteger(), connection->getUdpPort()});
         }
+        connection->setUdpEndpoint(address, port);
+        udpEndpoints[{address.toInteger(), port}] = connection.get();
 
-        broadcastChatMessage(senderId, message);
-      }
-    } else {
-      std::cerr << "Client disconnected or encountered an error." << std::endl;
-      auto it = std::find(connectedClients.begin(), connectedClients.end(), cSocket);
-      if (it != connectedClients.end()) {
-        connectedClients.erase(it);
+        sf::Packet reply;
+        reply << PACKET_UDP_HELLO;
+        sendDatagram(*connection, reply);
+        break;
       }
+    }
+    return;
+  }
+
+  // Everything else must come from an endpoint that has said hello; the
+  // sender's identity comes from that, never from the datagram.
+  auto it = udpEndpoints.find({address.toInteger(), port});
+  if (it == udpEndpoints.end()) {
+    return;
+  }
+  Connection& connection = *it->second;
+
+  if (packetType == PACKET_RELIABLE) {
+    std::vector<sf::Packet> delivered;
+    connection.getReliable().receive(packet, delivered);
+    for (auto& message : delivered) {
+      handlePacket(connection, message);
+    }
+  } else if (packetType == PACKET_RELIABLE_ACK) {
+    connection.getReliable().receiveAck(packet);
+  } else if (packetType == PACKET_INPUT) {
+    readInputCommands(connection, packet);
+  } else if (packetType == PACKET_SNAPSHOT_ACK) {
+    sf::Uint32 sequence;
+    if (SnapshotCodec::readVarint(packet, sequence)) {
+      connection.getSnapshotHistory().acknowledge(sequence);
+    }
+  }
+}
+
+// Commands the connection has already had are skipped, so the repeats in
+// each datagram only matter when an earlier one was lost. Any input
+// datagram, even one with nothing new, earns an ack: the client keeps
+// repeating until it gets one.
+void Server::readInputCommands(Connection& connection, sf::Packet& packet) {
+  sf::Uint32 newest;
+  sf::Uint8 count;
+  if (!(packet >> newest >> count) || count == 0 || newest < count) {
+    return;
+  }
+
+  sf::Uint32 sequence = newest - count + 1;
+  for (sf::Uint8 i = 0; i < count; ++i, ++sequence) {
+    InputCommand command{sequence, 0, 0.0f};
+    // A NaN or infinite dt would poison the position and every snapshot
+    // carrying it, so the rest of the datagram is untrusted too.
+    if (!(packet >> command.buttons >> command.dt) || !std::isfinite(command.dt)) {
+      return;
+    }
+    if (sequence > connection.getLastInputSequence()) {
+      command.dt = connection.takeInputTime(std::min(command.dt, MAX_INPUT_DT), networkClock.getElapsedTime());
+      pendingCommands.push_back({connection.getPlayerId(), command});
+      connection.setLastInputSequence(sequence);
+    }
+  }
+  connection.setInputAckPending(true);
+}
+
+bool Server::sendDatagram(Connection& connection, sf::Packet& packet) {
+  return simulator.send(udpSocket, packet, connection.getUdpAddress(), connection.getUdpPort()) == sf::Socket::Done;
+}
+
+// Clients without a UDP endpoint get the same packet over TCP, which is
+// already reliable and ordered.
+void Server::sendReliable(Connection& connection, ReliableChannel channel, sf::Packet& packet) {
+  if (connection.hasUdpEndpoint()) {
+    connection.getReliable().queue(channel, packet);
+  } else {
+    connection.queuePacket(packet);
+  }
+}
+
+void Server::flushReliable() {
+  sf::Time now = networkClock.getElapsedTime();
+  std::vector<sf::Packet> datagrams;
+  for (auto& connection : connections) {
+    if (!connection->hasUdpEndpoint()) {
+      continue;
+    }
+
+    ReliableEndpoint& reliable = connection->getReliable();
+    unsigned int resendsBefore = reliable.getResendCount();
+    datagrams.clear();
+    reliable.collectOutgoing(now, datagrams);
+    for (auto& datagram : datagrams) {
+      sendDatagram(*connection, datagram);
+    }
+    reliableResends += reliable.getResendCount() - resendsBefore;
+  }
+}
+
+void Server::broadcastPlayerEvent(PacketType type, int playerId) {
+  sf::Packet packet;
+  packet << type << playerId;
+  for (auto& connection : connections) {
+    if (connection->getProtocolVersion() >= 3) {
+      sendReliable(*connection, CHANNEL_EVENTS, packet);
+    }
+  }
+}
+
+void Server::handlePacket(Connection& connection, sf::Packet& packet) {
+  int packetType;
+  if (!(packet >> packetType)) {
+    return;
+  }
+
+  if (packetType == PACKET_POSITION) {
+    // Clients with a UDP endpoint send input commands instead, so a position
+    // from them is never trusted. The ID in the packet is ignored; the
+    // connection decides whose position it is.
+    int receivedPlayerId;
+    sf::Vector2f position;
+    if (!connection.hasUdpEndpoint() && (packet >> receivedPlayerId >> position.x >> position.y)) {
+      pendingInputs.push_back({connection.getPlayerId(), position});
+    }
+  } else if (packetType == PACKET_HELLO) {
+    sf::Uint8 clientVersion;
+    if (packet >> clientVersion) {
+      connection.setProtocolVersion(std::min(clientVersion, PROTOCOL_VERSION));
+    }
+  } else if (packetType == PACKET_SNAPSHOT_ACK) {
+    sf::Uint32 sequence;
+    if (SnapshotCodec::readVarint(packet, sequence)) {
+      connection.getSnapshotHistory().acknowledge(sequence);
+    }
+  } else if (packetType == PACKET_CHAT) {
+    int senderId;
+    std::string message;
+    packet >> senderId >> message;
+
+    if (!message.empty()) {
+      std::cout << "Received chat message from Player ID " << senderId << ": " << message << std::endl;
+    }
+
+    broadcastChatMessage(senderId, message);
+  }
+}
+
+void Server::tick() {
+  processInputs();
+  sendInputAcks();
+  broadcastSnapshot();
+  flushReliable();
+}
+
+void Server::processInputs() {
+  // Clients that only report positions cannot be simulated, but they can
+  // still be kept out of walls and held to roughly walking speed. The
+  // step is measured from where the player began the tick, so several
+  // reports in one tick can't add up to more than one step.
+  tickStartPositions.clear();
+  for (const auto& input : pendingInputs) {
+    const PlayerState* player = findPlayer(input.playerId);
+    sf::Vector2f tilePosition;
+    if (!player || collisionGrid.findOverlap(input.position, PLAYER_SIZE, tilePosition)) {
+      continue;
+    }
+    const sf::Vector2f& start = tickStartPositions.emplace(input.playerId, player->position).first->second;
+    sf::Vector2f step = input.position - start;
+    if (step.x * step.x + step.y * step.y <= MAX_POSITION_STEP * MAX_POSITION_STEP) {
+      updatePlayerPosition(input.playerId, input.position);
+    }
+  }
+  pendingInputs.clear();
+
+  for (const auto& pending : pendingCommands) {
+    const PlayerState* player = findPlayer(pending.playerId);
+    if (player) {
+      updatePlayerPosition(pending.playerId, simulateMovement(collisionGrid, player->position,
+                                                              pending.command.buttons, pending.command.dt));
+    }
+  }
+  pendingCommands.clear();
+}
+
+// Each client's own position, exact rather than quantized, with the last
+// input it reflects; the client rewinds to it and replays the rest.
+void Server::sendInputAcks() {
+  for (auto& connection : connections) {
+    if (!connection->isInputAckPending() || !connection->hasUdpEndpoint()) {
+      continue;
+    }
 
-      break;
+    const PlayerState* player = findPlayer(connection->getPlayerId());
+    if (player) {
+      sf::Packet ack;
+      ack << PACKET_INPUT_ACK << connection->getLastInputSequence() << player->position.x << player->position.y;
+      sendDatagram(*connection, ack);
     }
+    connection->setInputAckPending(false);
   }
 }
 
-void Server::broadcastPlayerPositions(sf::TcpSocket* sender) {
+void Server::reportTickStats() {
+  const TickStats& stats = scheduler.getStats();
+  if (stats.ticks > 0) {
+    float averageMs = stats.totalTickTime.asSeconds() * 1000.0f / stats.ticks;
+    std::cout << "Tick stats: " << stats.ticks << " ticks, " << stats.overruns << " overruns, "
+              << stats.skipped << " skipped, avg " << averageMs << " ms, max "
+              << stats.maxTickTime.asSeconds() * 1000.0f << " ms (budget "
+              << scheduler.getTickInterval().asSeconds() * 1000.0f << " ms)" << std::endl;
+    std::cout << "Snapshot traffic: " << players.size() << " players, "
+              << snapshotBytes / stats.ticks << " bytes/tick, "
+              << visibilityEvents << " enter/leave events, " << reliableResends << " reliable resends"
+              << std::endl;
+  }
+  snapshotBytes = 0;
+  visibilityEvents = 0;
+  reliableResends = 0;
+  scheduler.resetStats();
+  statsClock.restart();
+}
+
+void Server::flushConnections() {
+  for (auto& connection : connections) {
+    connection->flush();
+  }
+}
+
+void Server::removeClosedConnections() {
+  for (auto it = connections.begin(); it != connections.end();) {
+    if ((*it)->isOpen()) {
+      ++it;
+      continue;
+    }
+
+    int playerId = (*it)->getPlayerId();
+    dirtyPlayers.erase(playerId);
+    players.erase(playerId);
+
+    if ((*it)->hasUdpEndpoint()) {
+      udpEndpoints.erase({(*it)->getUdpAddress().toInteger(), (*it)->getUdpPort()});
+    }
+    selector.remove((*it)->getSocket());
+    it = connections.erase(it);
+    broadcastPlayerEvent(PACKET_PLAYER_LEFT, playerId);
+  }
+}
+
+void Server::writeSnapshot(sf::Packet& packet, const std::vector<PlayerState>& states, sf::Uint8 version) const {
+  if (version >= 1) {
+    codec.writeSnapshot(packet, states);
+    return;
+  }
+
+  packet << PACKET_SNAPSHOT << static_cast<int>(states.size());
+  for (const auto& state : states) {
+    packet << state.id << state.position.x << state.position.y;
+  }
+}
+
+const PlayerState* Server::findPlayer(int playerId) const {
+  return players.find(playerId);
+}
+
+// Recomputes which players this client can see. The ids that just came into
+// view are returned in `entered`; the client learns about the ones that left
+// from the removed list of its next delta.
+void Server::updateVisibility(Connection& connection, std::vector<int>& entered) {
+  std::vector<int> visible;
+  const PlayerState* self = findPlayer(connection.getPlayerId());
+  if (self) {
+    float radius = viewRadiusTiles * std::max(collisionGrid.getCellSize().x, collisionGrid.getCellSize().y);
+    spatialGrid.query(self->position, radius, visible);
+  }
+
+  std::vector<int> left;
+  updateVisibleSet(visible, connection.getVisiblePlayers(), entered, left);
+  visibilityEvents += entered.size() + left.size();
+}
+
+// One packet per client per tick, instead of one packet per player per
+// client per update, and only carrying the players inside that client's view
+// radius. Delta clients get a diff against the snapshot they last acked;
+// clients on the older formats get the visible players that moved this tick
+// or just came into view.
+void Server::broadcastSnapshot() {
+  spatialGrid.clear();
   for (const auto& player : players) {
-    sf::Packet packet;
-    packet << 0 << player.getId() << player.getPosition().x << player.getPosition().y;
+    spatialGrid.insert(player.id, player.position);
+  }
+
+  std::vector<QuantizedState> allStates;
+  bool quantized = false;
+
+  for (auto& client : connections) {
+    std::size_t bytesBefore = client->getBytesQueued();
+    std::vector<int> entered;
+    updateVisibility(*client, entered);
+    const std::vector<int>& visible = client->getVisiblePlayers();
+
+    if (client->getProtocolVersion() >= 2) {
+      if (!quantized) {
+        allStates = codec.quantizeStates(players.getValues());
+        quantized = true;
+      }
 
-    for (auto& client : connectedClients) {
-      if (client != sender) {
-        if (client->send(packet) != sf::Socket::Done) {
-          std::cerr << "Failed to broadcast player positions to a client." << std::endl;
+      // Both lists are sorted by id.
+      std::vector<QuantizedState> current;
+      auto id = visible.begin();
+      for (const auto& state : allStates) {
+        while (id != visible.end() && *id < static_cast<int>(state.id)) {
+          ++id;
+        }
+        if (id != visible.end() && *id == static_cast<int>(state.id)) {
+          current.push_back(state);
+        }
+      }
+      sendDeltaSnapshot(*client, current);
+    } else {
+      std::vector<PlayerState> states;
+      for (int playerId : visible) {
+        if (dirtyPlayers.count(playerId) || std::binary_search(entered.begin(), entered.end(), playerId)) {
+          states.push_back(*findPlayer(playerId));
         }
       }
+
+      if (!states.empty()) {
+        sf::Packet packet;
+        writeSnapshot(packet, states, client->getProtocolVersion());
+        client->queuePacket(packet);
+      }
+    }
+
+    snapshotBytes += client->getBytesQueued() - bytesBefore;
+  }
+
+  dirtyPlayers.clear();
+}
+
+void Server::sendDeltaSnapshot(Connection& connection, const std::vector<QuantizedState>& current) {
+  SnapshotHistory& history = connection.getSnapshotHistory();
+
+  // Nothing moved since the last snapshot and the client already has it:
+  // an idle lobby costs no bytes at all.
+  const std::vector<QuantizedState>* latest = history.getLatest();
+  if (latest && *latest == current && history.getBaselineSequence() == history.getLatestSequence()) {
+    return;
+  }
+
+  // A TCP client that is falling behind skips snapshots until it drains;
+  // the next one is a delta against whatever it acknowledged, so nothing is
+  // lost but time.
+  if (!connection.hasUdpEndpoint() && connection.isCongested()) {
+    return;
+  }
+
+  sf::Uint32 sequence = history.getLatestSequence() + 1;
+  sf::Packet packet;
+  if (!codec.writeDelta(packet, sequence, history.getBaselineSequence(), history.getBaseline(), current) && latest) {
+    return;
+  }
+
+  history.store(sequence, current);
+  // Over UDP a lost delta is simply superseded: the next one is still
+  // encoded against the last baseline the client acknowledged.
+  if (connection.hasUdpEndpoint()) {
+    if (sendDatagram(connection, packet)) {
+      snapshotBytes += packet.getDataSize();
     }
+  } else {
+    connection.queuePacket(packet);
   }
 }
 
 void Server::broadcastChatMessage(int senderId, const std::string& message) {
   if (!message.empty()) {
     sf::Packet chatPacket;
-    chatPacket << 1 << senderId << message;
+    chatPacket << PACKET_CHAT << senderId << message;
 
     std::cout << "Broadcasting message from Player ID " << senderId << ": " << message << std::endl;
 
-    for (auto& client : connectedClients) {
-      if (client->send(chatPacket) != sf::Socket::Done) {
-        std::cerr << "Failed to send chat message to client connected at address: " << client->getRemoteAddress() << std::endl;
-      }
+    for (auto& client : connections) {
+      sendReliable(*client, CHANNEL_CHAT, chatPacket);
     }
   }
-}
\ No newline at end of file
+}
@@ -5,27 +5,98 @@
 #include <SFML/Network.hpp>
 #include <vector>
 #include <memory>
-#include <mutex>
-#include "Player.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <random>
+#include <utility>
+#include <string>
+#include "CollisionGrid.h"
+#include "Connection.h"
+#include "EntityTable.h"
+#include "Movement.h"
+#include "NetworkSimulator.h"
+#include "PlayerState.h"
+#include "SnapshotCodec.h"
+#include "SpatialGrid.h"
+#include "TickScheduler.h"
 
 
 
 class Server {
  public:
-  Server();
+  explicit Server(unsigned int tickRate = 30);
+  bool loadMap(const std::string& path);
+  // Clients only hear about players within this many tiles of their own.
+  void setViewRadius(float tiles) { viewRadiusTiles = tiles; }
   void init();
   void run();
-  void handleClient(sf::TcpSocket* cSocket);
-  void broadcastPlayerPositions(sf::TcpSocket* sender);
+  void broadcastSnapshot();
   void updatePlayerPosition(int playerId, sf::Vector2f position);
   void broadcastChatMessage(int senderId, const std::string& message);
 
  private:
+  void acceptConnection();
+  void receiveFromConnection(Connection& connection);
+  void handlePacket(Connection& connection, sf::Packet& packet);
+  void receiveDatagrams();
+  void handleDatagram(sf::Packet& packet, const sf::IpAddress& address, unsigned short port);
+  bool sendDatagram(Connection& connection, sf::Packet& packet);
+  void sendReliable(Connection& connection, ReliableChannel channel, sf::Packet& packet);
+  void flushReliable();
+  void broadcastPlayerEvent(PacketType type, int playerId);
+  void flushConnections();
+  void removeClosedConnections();
+  void writeSnapshot(sf::Packet& packet, const std::vector<PlayerState>& states, sf::Uint8 version) const;
+  void sendDeltaSnapshot(Connection& connection, const std::vector<QuantizedState>& current);
+  const PlayerState* findPlayer(int playerId) const;
+  void updateVisibility(Connection& connection, std::vector<int>& entered);
+  void tick();
+  void processInputs();
+  void readInputCommands(Connection& connection, sf::Packet& packet);
+  void sendInputAcks();
+  void reportTickStats();
+
+  // Positions from clients that send them over TCP (older clients, or
+  // before UDP is up). Only checked against walls and walking speed; input
+  // commands are simulated properly.
+  struct PendingInput {
+    int playerId;
+    sf::Vector2f position;
+  };
+
+  struct PendingCommand {
+    int playerId;
+    InputCommand command;
+  };
+
   std::unique_ptr<sf::TcpListener> listener;
-  std::vector<sf::TcpSocket*> connectedClients;
-  std::mutex clientsMutex;
-  std::vector<Player> players;
-  int nextPlayerId;
+  sf::UdpSocket udpSocket;
+  // Registered UDP endpoints (address, port) and the connection they belong to.
+  std::map<std::pair<sf::Uint32, unsigned short>, Connection*> udpEndpoints;
+  std::mt19937 tokenGenerator;
+  NetworkSimulator simulator;
+  sf::Clock networkClock;
+  sf::SocketSelector selector;
+  std::vector<std::unique_ptr<Connection>> connections;
+  // Keyed by player ID; see EntityTable.
+  EntityTable<PlayerState> players;
+  std::unordered_set<int> dirtyPlayers;
+  std::vector<PendingInput> pendingInputs;
+  // Scratch for processInputs: each reporting player's position before the tick.
+  std::unordered_map<int, sf::Vector2f> tickStartPositions;
+  std::vector<PendingCommand> pendingCommands;
+  TickScheduler scheduler;
+  sf::Clock statsClock;
+
+  // Only the map's collision data is kept; nothing graphical.
+  CollisionGrid collisionGrid;
+  SnapshotCodec codec;
+  SpatialGrid spatialGrid;
+  float viewRadiusTiles = 16.0f;
+  std::size_t snapshotBytes = 0;
+  std::size_t visibilityEvents = 0;
+  unsigned int reliableResends = 0;
 };
 
-#endif // SERVER_H
\ No newline at end of file
+#endif // SERVER_H
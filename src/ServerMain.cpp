@@ -0,0 +1,53 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include "Protocol.h"
+#include "Server.h"
+
+// Dedicated server entry point. No window, textures or fonts are created;
+// only the map is loaded, for its collision data.
+//
+// Usage: SFMLGameServer [tickRate] [mapPath] [viewRadiusTiles]
+int main(int argc, char* argv[])
+{
+  unsigned int tickRate = 30;
+  std::string mapPath = MAP_PATH;
+
+  if (argc > 1)
+  {
+    int requested = std::atoi(argv[1]);
+    if (requested <= 0)
+    {
+      std::cerr << "Invalid tick rate: " << argv[1] << std::endl;
+      return 1;
+    }
+    tickRate = static_cast<unsigned int>(requested);
+  }
+
+  if (argc > 2)
+  {
+    mapPath = argv[2];
+  }
+
+  Server server(tickRate);
+  if (argc > 3)
+  {
+    float radius = static_cast<float>(std::atof(argv[3]));
+    if (radius <= 0.0f)
+    {
+      std::cerr << "Invalid view radius: " << argv[3] << std::endl;
+      return 1;
+    }
+    server.setViewRadius(radius);
+  }
+
+  if (!server.loadMap(mapPath))
+  {
+    return 1;
+  }
+
+  server.init();
+  server.run();
+
+  return 0;
+}
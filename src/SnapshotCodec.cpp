@@ -0,0 +1,224 @@
+#include "SnapshotCodec.h"
+#include "Protocol.h"
+#include "SnapshotHistory.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  const float QUANTIZED_MAX = 65535.0f;
+  // A varint never needs more than five bytes for 32 bits.
+  const int MAX_VARINT_BYTES = 5;
+
+  // Format versions carried in the packets themselves, so a snapshot is
+  // only decoded by code that knows its layout.
+  const sf::Uint8 COMPACT_FORMAT_VERSION = 1;
+  const sf::Uint8 DELTA_FORMAT_VERSION = 2;
+
+  const sf::Uint8 FIELD_X = 1;
+  const sf::Uint8 FIELD_Y = 2;
+
+  bool lessById(const QuantizedState& a, const QuantizedState& b) {
+    return a.id < b.id;
+  }
+}
+
+void SnapshotCodec::writeSnapshot(sf::Packet& packet, const std::vector<PlayerState>& players) const {
+  packet << PACKET_SNAPSHOT_COMPACT << COMPACT_FORMAT_VERSION;
+  writeVarint(packet, static_cast<sf::Uint32>(players.size()));
+
+  for (const auto& player : players) {
+    writeVarint(packet, static_cast<sf::Uint32>(player.id));
+    packet << quantize(player.position.x, worldSize.x) << quantize(player.position.y, worldSize.y);
+  }
+}
+
+bool SnapshotCodec::readSnapshot(sf::Packet& packet, std::vector<PlayerState>& players) const {
+  sf::Uint8 version;
+  sf::Uint32 count;
+  if (!(packet >> version) || version != COMPACT_FORMAT_VERSION || !readVarint(packet, count)) {
+    return false;
+  }
+
+  for (sf::Uint32 i = 0; i < count; ++i) {
+    sf::Uint32 id;
+    sf::Uint16 x, y;
+    if (!readVarint(packet, id) || !(packet >> x >> y)) {
+      return false;
+    }
+    players.push_back({static_cast<int>(id), sf::Vector2f(dequantize(x, worldSize.x), dequantize(y, worldSize.y))});
+  }
+  return true;
+}
+
+std::vector<QuantizedState> SnapshotCodec::quantizeStates(const std::vector<PlayerState>& players) const {
+  std::vector<QuantizedState> states;
+  states.reserve(players.size());
+  for (const auto& player : players) {
+    states.push_back({static_cast<sf::Uint32>(player.id), quantize(player.position.x, worldSize.x),
+                      quantize(player.position.y, worldSize.y)});
+  }
+  std::sort(states.begin(), states.end(), lessById);
+  return states;
+}
+
+PlayerState SnapshotCodec::dequantizeState(const QuantizedState& state) const {
+  return {static_cast<int>(state.id), sf::Vector2f(dequantize(state.x, worldSize.x), dequantize(state.y, worldSize.y))};
+}
+
+bool SnapshotCodec::writeDelta(sf::Packet& packet, sf::Uint32 sequence, sf::Uint32 baselineSequence,
+                               const std::vector<QuantizedState>* baseline,
+                               const std::vector<QuantizedState>& current) const {
+  static const std::vector<QuantizedState> none;
+  const std::vector<QuantizedState>& previous = baseline ? *baseline : none;
+  if (!baseline) {
+    baselineSequence = 0;
+  }
+
+  // Both lists are sorted by id, so one merge pass finds what was added,
+  // changed or removed.
+  sf::Packet changes;
+  sf::Uint32 changedCount = 0;
+  std::vector<sf::Uint32> removed;
+
+  auto before = previous.begin();
+  for (const auto& state : current) {
+    while (before != previous.end() && before->id < state.id) {
+      removed.push_back(before->id);
+      ++before;
+    }
+
+    sf::Uint8 mask = FIELD_X | FIELD_Y;
+    if (before != previous.end() && before->id == state.id) {
+      mask = (before->x != state.x ? FIELD_X : 0) | (before->y != state.y ? FIELD_Y : 0);
+      ++before;
+    }
+    if (mask == 0) {
+      continue;
+    }
+
+    ++changedCount;
+    writeVarint(changes, state.id);
+    changes << mask;
+    if (mask & FIELD_X) {
+      changes << state.x;
+    }
+    if (mask & FIELD_Y) {
+      changes << state.y;
+    }
+  }
+  for (; before != previous.end(); ++before) {
+    removed.push_back(before->id);
+  }
+
+  packet << PACKET_SNAPSHOT_DELTA << DELTA_FORMAT_VERSION;
+  writeVarint(packet, sequence);
+  writeVarint(packet, baselineSequence);
+  writeVarint(packet, changedCount);
+  packet.append(changes.getData(), changes.getDataSize());
+  writeVarint(packet, static_cast<sf::Uint32>(removed.size()));
+  for (sf::Uint32 id : removed) {
+    writeVarint(packet, id);
+  }
+
+  return changedCount > 0 || !removed.empty();
+}
+
+bool SnapshotCodec::readDelta(sf::Packet& packet, const SnapshotHistory& history, sf::Uint32& sequence,
+                              std::vector<QuantizedState>& states) const {
+  sf::Uint8 version;
+  sf::Uint32 baselineSequence;
+  if (!(packet >> version) || version != DELTA_FORMAT_VERSION || !readVarint(packet, sequence) ||
+      !readVarint(packet, baselineSequence)) {
+    return false;
+  }
+
+  states.clear();
+  if (baselineSequence != 0) {
+    const std::vector<QuantizedState>* baseline = history.find(baselineSequence);
+    if (!baseline) {
+      return false;
+    }
+    states = *baseline;
+  }
+
+  sf::Uint32 changedCount;
+  if (!readVarint(packet, changedCount)) {
+    return false;
+  }
+  for (sf::Uint32 i = 0; i < changedCount; ++i) {
+    QuantizedState change = {0, 0, 0};
+    sf::Uint8 mask;
+    if (!readVarint(packet, change.id) || !(packet >> mask)) {
+      return false;
+    }
+
+    auto it = std::lower_bound(states.begin(), states.end(), change, lessById);
+    if (it == states.end() || it->id != change.id) {
+      it = states.insert(it, change);
+    }
+    if ((mask & FIELD_X) && !(packet >> it->x)) {
+      return false;
+    }
+    if ((mask & FIELD_Y) && !(packet >> it->y)) {
+      return false;
+    }
+  }
+
+  sf::Uint32 removedCount;
+  if (!readVarint(packet, removedCount)) {
+    return false;
+  }
+  for (sf::Uint32 i = 0; i < removedCount; ++i) {
+    QuantizedState gone = {0, 0, 0};
+    if (!readVarint(packet, gone.id)) {
+      return false;
+    }
+    auto it = std::lower_bound(states.begin(), states.end(), gone, lessById);
+    if (it != states.end() && it->id == gone.id) {
+      states.erase(it);
+    }
+  }
+  return true;
+}
+
+sf::Uint16 SnapshotCodec::quantize(float value, float range) const {
+  if (range <= 0.0f) {
+    return 0;
+  }
+
+  float scaled = std::round(value / range * QUANTIZED_MAX);
+  if (scaled < 0.0f) {
+    return 0;
+  }
+  if (scaled > QUANTIZED_MAX) {
+    return static_cast<sf::Uint16>(QUANTIZED_MAX);
+  }
+  return static_cast<sf::Uint16>(scaled);
+}
+
+float SnapshotCodec::dequantize(sf::Uint16 value, float range) const {
+  return value / QUANTIZED_MAX * range;
+}
+
+void SnapshotCodec::writeVarint(sf::Packet& packet, sf::Uint32 value) {
+  while (value >= 0x80) {
+    packet << static_cast<sf::Uint8>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  packet << static_cast<sf::Uint8>(value);
+}
+
+bool SnapshotCodec::readVarint(sf::Packet& packet, sf::Uint32& value) {
+  value = 0;
+  for (int i = 0; i < MAX_VARINT_BYTES; ++i) {
+    sf::Uint8 byte;
+    if (!(packet >> byte)) {
+      return false;
+    }
+    value |= static_cast<sf::Uint32>(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,72 @@
+#ifndef SNAPSHOT_CODEC_H
+#define SNAPSHOT_CODEC_H
+
+#include <SFML/Network.hpp>
+#include <vector>
+#include "PlayerState.h"
+
+class SnapshotHistory;
+
+// A player position as it goes over the wire. Deltas compare these rather
+// than floats, so movement too small to survive quantization costs nothing.
+struct QuantizedState {
+  sf::Uint32 id;
+  sf::Uint16 x;
+  sf::Uint16 y;
+
+  bool operator==(const QuantizedState& other) const {
+    return id == other.id && x == other.x && y == other.y;
+  }
+  bool operator!=(const QuantizedState& other) const { return !(*this == other); }
+};
+
+// Compact encoding for PACKET_SNAPSHOT_COMPACT:
+//   Uint8 version, varint count, then per player
+//   varint id, Uint16 x, Uint16 y
+//
+// and for PACKET_SNAPSHOT_DELTA:
+//   Uint8 version, varint sequence, varint baseline sequence (0 = none),
+//   varint changed count, then per player
+//     varint id, Uint8 field mask (1 = x, 2 = y), the masked Uint16 fields
+//   varint removed count, then that many varint ids
+//
+// Positions are fixed point across the world bounds (map tile count x tile
+// size x MAP_SCALE), so both ends must agree on the world size; the server
+// sends it with the handshake.
+class SnapshotCodec {
+ public:
+  SnapshotCodec() = default;
+  explicit SnapshotCodec(const sf::Vector2f& worldSize) : worldSize(worldSize) {}
+
+  const sf::Vector2f& getWorldSize() const { return worldSize; }
+  void setWorldSize(const sf::Vector2f& size) { worldSize = size; }
+
+  void writeSnapshot(sf::Packet& packet, const std::vector<PlayerState>& players) const;
+  // Expects the packet type to have been read already.
+  bool readSnapshot(sf::Packet& packet, std::vector<PlayerState>& players) const;
+
+  // Sorted by id, which is what the delta functions expect.
+  std::vector<QuantizedState> quantizeStates(const std::vector<PlayerState>& players) const;
+  PlayerState dequantizeState(const QuantizedState& state) const;
+
+  // Writes the difference between `baseline` (may be null when the peer has
+  // nothing yet) and `current`. Returns false if nothing changed, in which
+  // case the packet holds a valid but empty delta.
+  bool writeDelta(sf::Packet& packet, sf::Uint32 sequence, sf::Uint32 baselineSequence,
+                  const std::vector<QuantizedState>* baseline, const std::vector<QuantizedState>& current) const;
+  // Expects the packet type to have been read already. Fails if the
+  // baseline the delta refers to is not in `history`.
+  bool readDelta(sf::Packet& packet, const SnapshotHistory& history, sf::Uint32& sequence,
+                 std::vector<QuantizedState>& states) const;
+
+  sf::Uint16 quantize(float value, float range) const;
+  float dequantize(sf::Uint16 value, float range) const;
+
+  static void writeVarint(sf::Packet& packet, sf::Uint32 value);
+  static bool readVarint(sf::Packet& packet, sf::Uint32& value);
+
+ private:
+  sf::Vector2f worldSize;
+};
+
+#endif // SNAPSHOT_CODEC_H
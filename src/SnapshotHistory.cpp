@@ -0,0 +1,35 @@
+#include "SnapshotHistory.h"
+
+void SnapshotHistory::store(sf::Uint32 sequence, const std::vector<QuantizedState>& states) {
+  if (sequence == 0) {
+    return;
+  }
+
+  Entry& entry = entries[sequence % CAPACITY];
+  entry.sequence = sequence;
+  entry.states = states;
+  if (sequence > latestSequence) {
+    latestSequence = sequence;
+  }
+}
+
+const std::vector<QuantizedState>* SnapshotHistory::find(sf::Uint32 sequence) const {
+  if (sequence == 0) {
+    return nullptr;
+  }
+
+  const Entry& entry = entries[sequence % CAPACITY];
+  return entry.sequence == sequence ? &entry.states : nullptr;
+}
+
+void SnapshotHistory::acknowledge(sf::Uint32 sequence) {
+  if (sequence > baselineSequence && find(sequence)) {
+    baselineSequence = sequence;
+  }
+}
+
+void SnapshotHistory::clear() {
+  entries = {};
+  baselineSequence = 0;
+  latestSequence = 0;
+}
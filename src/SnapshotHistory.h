@@ -0,0 +1,42 @@
+#ifndef SNAPSHOT_HISTORY_H
+#define SNAPSHOT_HISTORY_H
+
+#include <SFML/Config.hpp>
+#include <array>
+#include <vector>
+#include "SnapshotCodec.h"
+
+// The last few snapshots exchanged with one peer, by sequence number. The
+// server keeps what it sent to each client so it can diff against whatever
+// that client acknowledged last; the client keeps what it decoded so the
+// next delta has a baseline to apply to. Sequence 0 means "no snapshot".
+class SnapshotHistory {
+ public:
+  static const std::size_t CAPACITY = 32;
+
+  void store(sf::Uint32 sequence, const std::vector<QuantizedState>& states);
+  const std::vector<QuantizedState>* find(sf::Uint32 sequence) const;
+
+  // Marks a stored snapshot as received by the peer. Older or unknown
+  // sequences are ignored, so the baseline only moves forward.
+  void acknowledge(sf::Uint32 sequence);
+  sf::Uint32 getBaselineSequence() const { return baselineSequence; }
+  const std::vector<QuantizedState>* getBaseline() const { return find(baselineSequence); }
+
+  sf::Uint32 getLatestSequence() const { return latestSequence; }
+  const std::vector<QuantizedState>* getLatest() const { return find(latestSequence); }
+
+  void clear();
+
+ private:
+  struct Entry {
+    sf::Uint32 sequence = 0;
+    std::vector<QuantizedState> states;
+  };
+
+  std::array<Entry, CAPACITY> entries;
+  sf::Uint32 baselineSequence = 0;
+  sf::Uint32 latestSequence = 0;
+};
+
+#endif // SNAPSHOT_HISTORY_H
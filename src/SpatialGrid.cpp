@@ -0,0 +1,62 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+void SpatialGrid::reset(unsigned int columns, unsigned int rows, const sf::Vector2f& tileSize, unsigned int cellTiles) {
+  cellTiles = std::max(1u, cellTiles);
+  cellColumns = std::max(1u, (columns + cellTiles - 1) / cellTiles);
+  cellRows = std::max(1u, (rows + cellTiles - 1) / cellTiles);
+  cellSize = sf::Vector2f(std::max(1.0f, tileSize.x * cellTiles), std::max(1.0f, tileSize.y * cellTiles));
+  cells.assign(cellColumns * cellRows, std::vector<Entry>());
+}
+
+void SpatialGrid::clear() {
+  for (auto& cell : cells) {
+    cell.clear();
+  }
+}
+
+// Anything outside the map is clamped into the border cells, so players who
+// wander off the edge are still found.
+int SpatialGrid::cellColumn(float x) const {
+  int column = static_cast<int>(std::floor(x / cellSize.x));
+  return std::min(std::max(column, 0), static_cast<int>(cellColumns) - 1);
+}
+
+int SpatialGrid::cellRow(float y) const {
+  int row = static_cast<int>(std::floor(y / cellSize.y));
+  return std::min(std::max(row, 0), static_cast<int>(cellRows) - 1);
+}
+
+void SpatialGrid::insert(int id, const sf::Vector2f& position) {
+  cells[cellRow(position.y) * cellColumns + cellColumn(position.x)].push_back({id, position});
+}
+
+void SpatialGrid::query(const sf::Vector2f& center, float radius, std::vector<int>& ids) const {
+  int firstColumn = cellColumn(center.x - radius);
+  int lastColumn = cellColumn(center.x + radius);
+  int firstRow = cellRow(center.y - radius);
+  int lastRow = cellRow(center.y + radius);
+  float radiusSquared = radius * radius;
+
+  for (int row = firstRow; row <= lastRow; ++row) {
+    for (int column = firstColumn; column <= lastColumn; ++column) {
+      for (const auto& entry : cells[row * cellColumns + column]) {
+        float dx = entry.position.x - center.x;
+        float dy = entry.position.y - center.y;
+        if (dx * dx + dy * dy <= radiusSquared) {
+          ids.push_back(entry.id);
+        }
+      }
+    }
+  }
+}
+
+void updateVisibleSet(std::vector<int>& visible, std::vector<int>& previous, std::vector<int>& entered,
+                      std::vector<int>& left) {
+  std::sort(visible.begin(), visible.end());
+  std::set_difference(visible.begin(), visible.end(), previous.begin(), previous.end(), std::back_inserter(entered));
+  std::set_difference(previous.begin(), previous.end(), visible.begin(), visible.end(), std::back_inserter(left));
+  previous.swap(visible);
+}
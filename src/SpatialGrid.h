@@ -0,0 +1,43 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+
+// Uniform grid over the map for "who is near this point" queries. Cells are
+// a whole number of map tiles across. The server refills it once per tick
+// and then asks it which players each client can see, so a query only looks
+// at the few cells around the viewer rather than at every player.
+class SpatialGrid {
+ public:
+  // `columns` x `rows` map tiles of `tileSize` world units, grouped into
+  // cells of `cellTiles` x `cellTiles` tiles.
+  void reset(unsigned int columns, unsigned int rows, const sf::Vector2f& tileSize, unsigned int cellTiles);
+
+  void clear();
+  void insert(int id, const sf::Vector2f& position);
+  // Appends the ids of everything within `radius` world units of `center`.
+  void query(const sf::Vector2f& center, float radius, std::vector<int>& ids) const;
+
+ private:
+  struct Entry {
+    int id;
+    sf::Vector2f position;
+  };
+
+  int cellColumn(float x) const;
+  int cellRow(float y) const;
+
+  unsigned int cellColumns = 1;
+  unsigned int cellRows = 1;
+  sf::Vector2f cellSize = sf::Vector2f(1.0f, 1.0f);
+  std::vector<std::vector<Entry>> cells = std::vector<std::vector<Entry>>(1);
+};
+
+// Sorts `visible`, the ids a viewer can see now, and swaps it into
+// `previous`, what it saw last time. Ids that came into view are appended to
+// `entered` and ids that went out of it to `left`.
+void updateVisibleSet(std::vector<int>& visible, std::vector<int>& previous, std::vector<int>& entered,
+                      std::vector<int>& left);
+
+#endif // SPATIAL_GRID_H
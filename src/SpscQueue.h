@@ -0,0 +1,59 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. The producer only writes `tail` and the consumer only writes
+// `head`; each reads the other's index with acquire ordering, which is all
+// the synchronisation a single slot handoff needs. The indices sit on
+// separate cache lines so the two threads do not keep invalidating each
+// other's line.
+//
+// Capacity must be a power of two. One slot is kept empty to tell a full
+// queue from an empty one, so it holds at most Capacity - 1 items.
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  // Producer side. Returns false, leaving `item` untouched, if full.
+  bool push(T&& item) {
+    std::size_t tailIndex = tail.load(std::memory_order_relaxed);
+    std::size_t next = (tailIndex + 1) & (Capacity - 1);
+    if (next == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots[tailIndex] = std::move(item);
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool push(const T& item) {
+    T copy(item);
+    return push(std::move(copy));
+  }
+
+  // Consumer side. Returns false if there is nothing to take.
+  bool pop(T& item) {
+    std::size_t headIndex = head.load(std::memory_order_relaxed);
+    if (headIndex == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = std::move(slots[headIndex]);
+    head.store((headIndex + 1) & (Capacity - 1), std::memory_order_release);
+    return true;
+  }
+
+ private:
+  static const std::size_t CACHE_LINE = 64;
+
+  alignas(CACHE_LINE) std::atomic<std::size_t> head{0};
+  alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};
+  alignas(CACHE_LINE) std::array<T, Capacity> slots;
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,50 @@
+#include "TickScheduler.h"
+
+namespace {
+  // If the loop falls further behind than this, the missed ticks are dropped
+  // instead of being run back to back, so one stall can't snowball.
+  const unsigned int MAX_CATCH_UP_TICKS = 3;
+}
+
+TickScheduler::TickScheduler(unsigned int rate)
+  : tickRate(rate > 0 ? rate : 1), interval(sf::seconds(1.0f / tickRate)) {
+  nextTick = clock.getElapsedTime() + interval;
+}
+
+sf::Time TickScheduler::timeUntilNextTick() const {
+  sf::Time remaining = nextTick - clock.getElapsedTime();
+  return remaining > sf::Time::Zero ? remaining : sf::Time::Zero;
+}
+
+bool TickScheduler::isTickDue() const {
+  return clock.getElapsedTime() >= nextTick;
+}
+
+void TickScheduler::beginTick() {
+  tickStart = clock.getElapsedTime();
+
+  sf::Time behind = tickStart - nextTick;
+  if (behind > interval * static_cast<float>(MAX_CATCH_UP_TICKS)) {
+    unsigned int missed = static_cast<unsigned int>(behind / interval);
+    stats.skipped += missed;
+    nextTick += interval * static_cast<float>(missed);
+  }
+  nextTick += interval;
+}
+
+void TickScheduler::endTick() {
+  sf::Time elapsed = clock.getElapsedTime() - tickStart;
+
+  ++stats.ticks;
+  stats.totalTickTime += elapsed;
+  if (elapsed > stats.maxTickTime) {
+    stats.maxTickTime = elapsed;
+  }
+  if (elapsed > interval) {
+    ++stats.overruns;
+  }
+}
+
+void TickScheduler::resetStats() {
+  stats = TickStats();
+}
@@ -0,0 +1,43 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <SFML/System.hpp>
+
+struct TickStats {
+  unsigned int ticks = 0;
+  // Ticks whose own work took longer than the tick interval.
+  unsigned int overruns = 0;
+  // Ticks dropped because the loop fell too far behind to catch up.
+  unsigned int skipped = 0;
+  sf::Time totalTickTime;
+  sf::Time maxTickTime;
+};
+
+// Fixed-rate clock for the server simulation. The event loop asks how long it
+// may sleep until the next tick, then brackets each tick with beginTick() /
+// endTick() so the cost of every tick is measured against its budget.
+class TickScheduler {
+ public:
+  explicit TickScheduler(unsigned int tickRate);
+
+  unsigned int getTickRate() const { return tickRate; }
+  sf::Time getTickInterval() const { return interval; }
+
+  sf::Time timeUntilNextTick() const;
+  bool isTickDue() const;
+  void beginTick();
+  void endTick();
+
+  const TickStats& getStats() const { return stats; }
+  void resetStats();
+
+ private:
+  unsigned int tickRate;
+  sf::Time interval;
+  sf::Clock clock;
+  sf::Time nextTick;
+  sf::Time tickStart;
+  TickStats stats;
+};
+
+#endif // TICK_SCHEDULER_H
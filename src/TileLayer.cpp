@@ -39,8 +39,11 @@ source distribution.
 #include <tmxlite/FreeFuncs.hpp>
 #include <tmxlite/TileLayer.hpp>
 #include <tmxlite/detail/Log.hpp>
+#include "detail/Threads.hpp"
 
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 using namespace tmx;
 
@@ -53,6 +56,390 @@ namespace
             Zlib, GZip, Zstd, None
         };
     };
+
+    TileLayer::Tile makeTile(std::uint32_t id)
+    {
+        static const std::uint32_t mask = 0xf0000000;
+
+        TileLayer::Tile tile;
+        tile.flipFlags = ((id & mask) >> 28);
+        tile.ID = id & ~mask;
+        return tile;
+    }
+
+    //base64 text of a layer, handed out as decoded bytes a block at a time
+    class Base64Reader final
+    {
+    public:
+        explicit Base64Reader(const char* text)
+            : m_text(text), m_remaining(std::strlen(text)) {}
+
+        //size should be a multiple of 3 so each read ends on a whole group
+        std::size_t read(unsigned char* dest, std::size_t size)
+        {
+            std::size_t used = 0;
+            auto count = base64_decode(m_text, m_remaining, dest, size, &used);
+            m_text += used;
+            m_remaining -= used;
+            if (count < size)
+            {
+                //hit the end of the text or its padding
+                m_remaining = 0;
+            }
+            return count;
+        }
+
+    private:
+        const char* m_text;
+        std::size_t m_remaining;
+    };
+
+    //turns little endian tile IDs into tiles as the bytes arrive, carrying
+    //any partial ID over to the next block
+    class TileWriter final
+    {
+    public:
+        TileWriter(std::vector<TileLayer::Tile>& tiles, std::size_t tileCount)
+            : m_tiles(tiles), m_tileCount(tileCount)
+        {
+            m_tiles.reserve(tileCount);
+        }
+
+        //returns false once every tile has been written
+        bool write(const unsigned char* data, std::size_t size)
+        {
+            const auto* end = data + size;
+
+            //finish an ID split across the previous block and this one
+            if (m_partialSize != 0)
+            {
+                while (m_partialSize < 4 && data != end)
+                {
+                    m_partial[m_partialSize++] = *data++;
+                }
+                if (m_partialSize < 4)
+                {
+                    return true;
+                }
+                addTile(m_partial);
+                m_partialSize = 0;
+            }
+
+            while (end - data >= 4 && m_tiles.size() < m_tileCount)
+            {
+                addTile(data);
+                data += 4;
+            }
+
+            if (m_tiles.size() == m_tileCount)
+            {
+                return false;
+            }
+
+            while (data != end)
+            {
+                m_partial[m_partialSize++] = *data++;
+            }
+            return true;
+        }
+
+    private:
+        std::vector<TileLayer::Tile>& m_tiles;
+        std::size_t m_tileCount;
+        unsigned char m_partial[4] = {};
+        std::size_t m_partialSize = 0;
+
+        void addTile(const unsigned char* bytes)
+        {
+            std::uint32_t id = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<std::uint32_t>(bytes[3]) << 24;
+            m_tiles.push_back(makeTile(id));
+        }
+    };
+
+    //one block of decoded base64 at a time; a multiple of 3, see Base64Reader
+    constexpr std::size_t DecodeBlockSize = 12 * 1024;
+
+    //decodes a layer or chunk's base64 text into tiles, inflating it first if
+    //need be. The data passes through fixed size blocks so the tile vector
+    //is the only allocation the size of the layer.
+    bool readBase64Tiles(const char* text, std::size_t tileCount, std::int32_t compressionType, std::vector<TileLayer::Tile>& tiles)
+    {
+        Base64Reader reader(text);
+        TileWriter writer(tiles, tileCount);
+
+        switch (compressionType)
+        {
+        default:
+        {
+            unsigned char block[DecodeBlockSize];
+            std::size_t count = 0;
+            while ((count = reader.read(block, DecodeBlockSize)) != 0
+                && writer.write(block, count)) {}
+        }
+            break;
+        case CompressionType::Zstd:
+#if defined USE_ZSTD || defined USE_EXTLIBS
+        {
+            unsigned char input[DecodeBlockSize];
+            unsigned char output[16 * 1024];
+
+            ZSTD_DStream* stream = ZSTD_createDStream();
+            ZSTD_initDStream(stream);
+
+            ZSTD_inBuffer in = { input, 0, 0 };
+            bool moreInput = true;
+            bool outputFull = false;
+            std::size_t result = 1;
+            while (result != 0)
+            {
+                if (in.pos == in.size && moreInput)
+                {
+                    in.size = reader.read(input, DecodeBlockSize);
+                    in.pos = 0;
+                    moreInput = in.size != 0;
+                }
+
+                if (in.pos == in.size && !moreInput && !outputFull)
+                {
+                    break;
+                }
+
+                ZSTD_outBuffer out = { output, sizeof(output), 0 };
+                result = ZSTD_decompressStream(stream, &out, &in);
+                if (ZSTD_isError(result))
+                {
+                    std::string err = ZSTD_getErrorName(result);
+                    LOG("Failed to decompress layer data, node skipped.\nError: " + err, Logger::Type::Error);
+                    ZSTD_freeDStream(stream);
+                    tiles.clear();
+                    return false;
+                }
+
+                outputFull = out.pos == out.size;
+                if (out.pos != 0 && !writer.write(output, out.pos))
+                {
+                    //the writer has all it wants, which is as good as the end
+                    result = 0;
+                    break;
+                }
+            }
+            ZSTD_freeDStream(stream);
+
+            //0 means a whole frame was decoded, anything else that the input
+            //ran out part way through
+            if (result != 0)
+            {
+                Logger::log("Compressed data ended before the end of the stream", Logger::Type::Error);
+                LOG("Failed to decompress layer data, node skipped.", Logger::Type::Error);
+                tiles.clear();
+                return false;
+            }
+        }
+            break;
+#else
+            Logger::log("Library must be built with USE_EXTLIBS or USE_ZSTD for Zstd compression", Logger::Type::Error);
+            return false;
+#endif
+        case CompressionType::GZip:
+#ifndef USE_EXTLIBS
+            Logger::log("Library must be built with USE_EXTLIBS for GZip compression", Logger::Type::Error);
+            return false;
+#endif
+            //[[fallthrough]];
+        case CompressionType::Zlib:
+            if (!decompress([&reader](unsigned char* dest, std::size_t size) { return reader.read(dest, size); },
+                [&writer](const unsigned char* data, std::size_t size) { return writer.write(data, size); }))
+            {
+                LOG("Failed to decompress layer data, node skipped.", Logger::Type::Error);
+                tiles.clear();
+                return false;
+            }
+            break;
+        }
+
+        return !tiles.empty();
+    }
+
+    bool isCSVSpace(char c)
+    {
+        //the same set strtoul skips: space, \t \n \v \f \r
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define TMX_CSV_SWAR
+    //IDs are read eight characters at a time as one little endian word, so
+    //the first character is in the lowest byte
+
+    //number of decimal digits at the start of word, 0 to 8
+    std::size_t leadingDigits(std::uint64_t word)
+    {
+        //a digit has 3 in its high nibble, and a low nibble which doesn't
+        //reach 16 when 6 is added. Neither test carries between bytes.
+        const std::uint64_t high = (word & 0xf0f0f0f0f0f0f0f0ull) ^ 0x3030303030303030ull;
+        const std::uint64_t low = ((word & 0x0f0f0f0f0f0f0f0full) + 0x0606060606060606ull) & 0x1010101010101010ull;
+        const std::uint64_t other = high | low;
+
+        //0x80 in each byte which isn't a digit
+        const std::uint64_t flags = (((other & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | other) & 0x8080808080808080ull;
+        if (flags == 0)
+        {
+            return 8;
+        }
+
+        //the lowest flag is 0x80 << 8n for n leading digits, and the
+        //multiply moves n into the top byte
+        return static_cast<std::size_t>((((flags & (0 - flags)) >> 7) * 0x0001020304050607ull) >> 56);
+    }
+
+    //value of the first count (1 to 8) digits of word
+    std::uint64_t parseDigits(std::uint64_t word, std::size_t count)
+    {
+        //shifting the digits to the top leaves zeros in front of them, so
+        //there are always eight. Anything after the digits is shifted out,
+        //including borrows from subtracting '0' from it.
+        word = (word - 0x3030303030303030ull) << (8 * (8 - count));
+
+        //pairs, then fours, then all eight digits
+        word = (word * 10) + (word >> 8);
+        word = (((word & 0x000000ff000000ffull) * (100 + (1000000ull << 32)))
+            + (((word >> 16) & 0x000000ff000000ffull) * (1 + (10000ull << 32)))) >> 32;
+        return word;
+    }
+
+    const std::uint64_t PowersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+#endif
+
+    //reads comma separated IDs from [begin, end) the way repeated calls to
+    //strtoul did, straight from the document's buffer. Returns false if it
+    //stopped on something other than an ID before reaching end.
+    bool scanCSV(const char* begin, const char* end, std::vector<TileLayer::Tile>& tiles)
+    {
+        const char* ptr = begin;
+        while (true)
+        {
+            while (ptr != end && isCSVSpace(*ptr))
+            {
+                ++ptr;
+            }
+
+            if (ptr == end)
+            {
+                return true;
+            }
+            //strtoul allows a sign, and wraps negative values around
+            bool negative = false;
+            if (*ptr == '+' || *ptr == '-')
+            {
+                negative = *ptr == '-';
+                ++ptr;
+            }
+            if (ptr == end || !isDigit(*ptr))
+            {
+                return false;
+            }
+
+            std::uint64_t value = 0;
+#ifdef TMX_CSV_SWAR
+            while (end - ptr >= 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, ptr, sizeof(word));
+                const auto count = leadingDigits(word);
+                if (count == 0)
+                {
+                    break;
+                }
+
+                value = value * PowersOf10[count] + parseDigits(word, count);
+                ptr += count;
+                if (count < 8)
+                {
+                    break;
+                }
+            }
+#endif
+            //the last few characters of the range
+            while (ptr != end && isDigit(*ptr))
+            {
+                value = value * 10 + (*ptr++ - '0');
+            }
+
+            if (negative)
+            {
+                value = 0 - value;
+            }
+
+            tiles.push_back(makeTile(static_cast<std::uint32_t>(value)));
+            if (ptr != end && *ptr == ',')
+            {
+                ++ptr;
+            }
+        }
+    }
+
+    //layers with less CSV text than this per thread are read on one thread
+    constexpr std::size_t MinCSVBytesPerThread = 256 * 1024;
+
+    //reads a layer or chunk's CSV text into tiles. Large layers are split at
+    //commas into ranges which are scanned in parallel and joined in order.
+    std::vector<TileLayer::Tile> readCSVTiles(const char* text, std::size_t tileCount)
+    {
+        const std::size_t length = std::strlen(text);
+        const char* end = text + length;
+
+        //a layer decoded by Map's thread pool is already one of several running at once
+        std::size_t threadCount = detail::inLoadPool() ? 1 :
+            std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), length / MinCSVBytesPerThread);
+
+        std::vector<const char*> bounds = { text };
+        for (auto i = 1u; i < threadCount; ++i)
+        {
+            const char* split = std::max(bounds.back(), text + (length / threadCount) * i);
+            split = static_cast<const char*>(std::memchr(split, ',', end - split));
+            if (!split)
+            {
+                break;
+            }
+            bounds.push_back(split + 1);
+        }
+        bounds.push_back(end);
+
+        const std::size_t rangeCount = bounds.size() - 1;
+        std::vector<std::vector<TileLayer::Tile>> ranges(rangeCount);
+        //not vector<bool>, whose elements share bytes between threads
+        std::vector<char> completed(rangeCount, 0);
+
+        //joins on the way out if starting a thread throws, before the ranges go
+        detail::ThreadGroup threads;
+        for (auto i = 1u; i < rangeCount; ++i)
+        {
+            threads.start([&, i]()
+                {
+                    ranges[i].reserve(tileCount / rangeCount + 1);
+                    completed[i] = scanCSV(bounds[i], bounds[i + 1], ranges[i]);
+                });
+        }
+
+        auto& tiles = ranges[0];
+        tiles.reserve(tileCount);
+        completed[0] = scanCSV(bounds[0], bounds[1], tiles);
+
+        threads.join();
+
+        //a range which stopped early is where a single pass would have
+        //stopped, so nothing after it is used
+        for (auto i = 1u; i < rangeCount && completed[i - 1]; ++i)
+        {
+            tiles.insert(tiles.end(), ranges[i].begin(), ranges[i].end());
+        }
+        return std::move(tiles);
+    }
 }
 
 TileLayer::TileLayer(std::size_t tileCount)
@@ -118,70 +505,6 @@ void TileLayer::parse(const pugi::xml_node& node, Map*)
 //private
 void TileLayer::parseBase64(const pugi::xml_node& node)
 {
-    auto processDataString = [](std::string dataString, std::size_t tileCount, std::int32_t compressionType)->std::vector<std::uint32_t>
-    {
-        std::stringstream ss;
-        ss << dataString;
-        ss >> dataString;
-        dataString = base64_decode(dataString);
-
-        std::size_t expectedSize = tileCount * 4; //4 bytes per tile
-        std::vector<unsigned char> byteData;
-        byteData.reserve(expectedSize);
-
-        switch (compressionType)
-        {
-        default:
-            byteData.insert(byteData.end(), dataString.begin(), dataString.end());
-            break;
-        case CompressionType::Zstd:
-#if defined USE_ZSTD || defined USE_EXTLIBS
-            {
-                std::size_t dataSize = dataString.length() * sizeof(unsigned char);
-                std::size_t result = ZSTD_decompress(byteData.data(), expectedSize, &dataString[0], dataSize);
-                
-                if (ZSTD_isError(result))
-                {
-                    std::string err = ZSTD_getErrorName(result);
-                    LOG("Failed to decompress layer data, node skipped.\nError: " + err, Logger::Type::Error);
-                }
-            }
-#else
-            Logger::log("Library must be built with USE_EXTLIBS or USE_ZSTD for Zstd compression", Logger::Type::Error);
-            return {};
-#endif
-        case CompressionType::GZip:
-#ifndef USE_EXTLIBS
-            Logger::log("Library must be built with USE_EXTLIBS for GZip compression", Logger::Type::Error);
-            return {};
-#endif
-            //[[fallthrough]];
-        case CompressionType::Zlib:
-        {
-            //unzip
-            std::size_t dataSize = dataString.length() * sizeof(unsigned char);
-
-            if (!decompress(dataString.c_str(), byteData, dataSize, expectedSize))
-            {
-                LOG("Failed to decompress layer data, node skipped.", Logger::Type::Error);
-                return {};
-            }
-        }
-            break;
-        }
-
-        //data stream is in bytes so we need to OR into 32 bit values
-        std::vector<std::uint32_t> IDs;
-        IDs.reserve(tileCount);
-        for (auto i = 0u; i < expectedSize - 3u; i += 4u)
-        {
-            std::uint32_t id = byteData[i] | byteData[i + 1] << 8 | byteData[i + 2] << 16 | byteData[i + 3] << 24;
-            IDs.push_back(id);
-        }
-
-        return IDs;
-    };
-
     std::int32_t compressionType = CompressionType::None;
     std::string compression = node.attribute("compression").as_string();
     if (compression == "gzip")
@@ -197,8 +520,10 @@ void TileLayer::parseBase64(const pugi::xml_node& node)
         compressionType = CompressionType::Zstd;
     }
 
-    std::string data = node.text().as_string();
-    if (data.empty())
+    //text() points straight into the parsed document, so the layer
+    //data is decoded where it lies rather than copied out first
+    const char* data = node.text().get();
+    if (*data == '\0')
     {
         //check for chunk nodes
         auto dataCount = 0;
@@ -207,8 +532,8 @@ void TileLayer::parseBase64(const pugi::xml_node& node)
             std::string childName = childNode.name();
             if (childName == "chunk")
             {
-                std::string dataString = childNode.text().as_string();
-                if (!dataString.empty())
+                const char* dataString = childNode.text().get();
+                if (*dataString != '\0')
                 {
                     Chunk chunk;
                     chunk.position.x = childNode.attribute("x").as_int();
@@ -217,14 +542,11 @@ void TileLayer::parseBase64(const pugi::xml_node& node)
                     chunk.size.x = childNode.attribute("width").as_int();
                     chunk.size.y = childNode.attribute("height").as_int();
 
-                    auto IDs = processDataString(dataString, (chunk.size.x * chunk.size.y), compressionType);
-
-                    if (!IDs.empty())
+                    if (readBase64Tiles(dataString, (chunk.size.x * chunk.size.y), compressionType, chunk.tiles))
                     {
-                        createTiles(IDs, chunk.tiles);
-                        m_chunks.push_back(chunk);
+                        m_chunks.push_back(std::move(chunk));
                         dataCount++;
-                    }                    
+                    }
                 }
             }
         }
@@ -237,34 +559,14 @@ void TileLayer::parseBase64(const pugi::xml_node& node)
     }
     else
     {
-        auto IDs = processDataString(data, m_tileCount, compressionType);
-        createTiles(IDs, m_tiles);
+        readBase64Tiles(data, m_tileCount, compressionType, m_tiles);
     }
 }
 
 void TileLayer::parseCSV(const pugi::xml_node& node)
 {
-    auto processDataString = [](const std::string dataString, std::size_t tileCount)->std::vector<std::uint32_t>
-    {
-        std::vector<std::uint32_t> IDs;
-        IDs.reserve(tileCount);
-
-        const char* ptr = dataString.c_str();
-        while (true)
-        {
-            char* end;
-            auto res = std::strtoul(ptr, &end, 10);
-            if (end == ptr) break;
-            ptr = end;
-            IDs.push_back(res);
-            if (*ptr == ',') ++ptr;
-        }
-
-        return IDs;
-    };
-
-    std::string data = node.text().as_string();
-    if (data.empty())
+    const char* data = node.text().get();
+    if (*data == '\0')
     {
         //check for chunk nodes
         auto dataCount = 0;
@@ -273,8 +575,8 @@ void TileLayer::parseCSV(const pugi::xml_node& node)
             std::string childName = childNode.name();
             if (childName == "chunk")
             {
-                std::string dataString = childNode.text().as_string();
-                if (!dataString.empty())
+                const char* dataString = childNode.text().get();
+                if (*dataString != '\0')
                 {
                     Chunk chunk;
                     chunk.position.x = childNode.attribute("x").as_int();
@@ -283,12 +585,11 @@ void TileLayer::parseCSV(const pugi::xml_node& node)
                     chunk.size.x = childNode.attribute("width").as_int();
                     chunk.size.y = childNode.attribute("height").as_int();
 
-                    auto IDs = processDataString(dataString, chunk.size.x * chunk.size.y);
+                    chunk.tiles = readCSVTiles(dataString, chunk.size.x * chunk.size.y);
 
-                    if (!IDs.empty())
+                    if (!chunk.tiles.empty())
                     {
-                        createTiles(IDs, chunk.tiles);
-                        m_chunks.push_back(chunk);
+                        m_chunks.push_back(std::move(chunk));
                         dataCount++;
                     }
                 }
@@ -303,7 +604,7 @@ void TileLayer::parseCSV(const pugi::xml_node& node)
     }
     else
     {
-        createTiles(processDataString(data, m_tileCount), m_tiles);
+        m_tiles = readCSVTiles(data, m_tileCount);
     }
 }
 
@@ -0,0 +1,110 @@
+#include "TileMapRenderer.h"
+#include <tmxlite/TileLayer.hpp>
+#include <algorithm>
+
+bool TileMapRenderer::load(const tmx::Map& map, std::shared_ptr<const sf::Texture> tilesetTexture) {
+  texture = std::move(tilesetTexture);
+  tileCount = sf::Vector2u(map.getTileCount().x, map.getTileCount().y);
+  tileSize = sf::Vector2u(map.getTileSize().x, map.getTileSize().y);
+  chunkCount = sf::Vector2u((tileCount.x + CHUNK_SIZE - 1) / CHUNK_SIZE, (tileCount.y + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  firstGid = map.getTilesets().empty() ? 1 : map.getTilesets().front().getFirstGID();
+  layers.clear();
+
+  if (!texture || tileSize.x == 0 || tileSize.y == 0) {
+    return false;
+  }
+
+  for (const auto& mapLayer : map.getLayers()) {
+    if (mapLayer->getType() != tmx::Layer::Type::Tile) {
+      continue;
+    }
+
+    const auto& tiles = mapLayer->getLayerAs<tmx::TileLayer>().getTiles();
+    Layer layer;
+    layer.tiles.assign(tileCount.x * tileCount.y, 0);
+    for (std::size_t i = 0; i < tiles.size() && i < layer.tiles.size(); ++i) {
+      layer.tiles[i] = tiles[i].ID;
+    }
+    layer.chunks.resize(chunkCount.x * chunkCount.y);
+    layers.push_back(std::move(layer));
+  }
+  return true;
+}
+
+std::uint32_t TileMapRenderer::getTile(std::size_t layer, unsigned int x, unsigned int y) const {
+  if (layer >= layers.size() || x >= tileCount.x || y >= tileCount.y) {
+    return 0;
+  }
+  return layers[layer].tiles[y * tileCount.x + x];
+}
+
+void TileMapRenderer::setTile(std::size_t layer, unsigned int x, unsigned int y, std::uint32_t tileId) {
+  if (layer >= layers.size() || x >= tileCount.x || y >= tileCount.y) {
+    return;
+  }
+
+  std::uint32_t& tile = layers[layer].tiles[y * tileCount.x + x];
+  if (tile != tileId) {
+    tile = tileId;
+    layers[layer].chunks[(y / CHUNK_SIZE) * chunkCount.x + x / CHUNK_SIZE].dirty = true;
+  }
+}
+
+void TileMapRenderer::rebuildChunk(const Layer& layer, std::size_t chunkIndex, Chunk& chunk) const {
+  chunk.vertices.setPrimitiveType(sf::Quads);
+  chunk.vertices.clear();
+  chunk.dirty = false;
+
+  unsigned int tilesPerRow = texture->getSize().x / tileSize.x;
+  if (tilesPerRow == 0) {
+    return;
+  }
+
+  unsigned int startX = static_cast<unsigned int>(chunkIndex % chunkCount.x) * CHUNK_SIZE;
+  unsigned int startY = static_cast<unsigned int>(chunkIndex / chunkCount.x) * CHUNK_SIZE;
+  unsigned int endX = std::min(startX + CHUNK_SIZE, tileCount.x);
+  unsigned int endY = std::min(startY + CHUNK_SIZE, tileCount.y);
+
+  for (unsigned int y = startY; y < endY; ++y) {
+    for (unsigned int x = startX; x < endX; ++x) {
+      std::uint32_t id = layer.tiles[y * tileCount.x + x];
+      if (id < firstGid) {
+        continue;
+      }
+
+      std::uint32_t local = id - firstGid;
+      float tu = static_cast<float>((local % tilesPerRow) * tileSize.x);
+      float tv = static_cast<float>((local / tilesPerRow) * tileSize.y);
+      float px = static_cast<float>(x * tileSize.x);
+      float py = static_cast<float>(y * tileSize.y);
+      float w = static_cast<float>(tileSize.x);
+      float h = static_cast<float>(tileSize.y);
+
+      chunk.vertices.append(sf::Vertex(sf::Vector2f(px, py), sf::Vector2f(tu, tv)));
+      chunk.vertices.append(sf::Vertex(sf::Vector2f(px + w, py), sf::Vector2f(tu + w, tv)));
+      chunk.vertices.append(sf::Vertex(sf::Vector2f(px + w, py + h), sf::Vector2f(tu + w, tv + h)));
+      chunk.vertices.append(sf::Vertex(sf::Vector2f(px, py + h), sf::Vector2f(tu, tv + h)));
+    }
+  }
+}
+
+void TileMapRenderer::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+  if (!texture) {
+    return;
+  }
+
+  states.transform *= getTransform();
+  states.texture = texture.get();
+
+  for (auto& layer : layers) {
+    for (std::size_t i = 0; i < layer.chunks.size(); ++i) {
+      Chunk& chunk = layer.chunks[i];
+      if (chunk.dirty) {
+        rebuildChunk(layer, i, chunk);
+      }
+      if (chunk.vertices.getVertexCount() > 0) {
+        target.draw(chunk.vertices, states);
+      }
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef TILE_MAP_RENDERER_H
+#define TILE_MAP_RENDERER_H
+
+#include <SFML/Graphics.hpp>
+#include <tmxlite/Map.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Draws the tile layers of a tmx::Map as batches of textured quads. Each
+// layer is cut into CHUNK_SIZE x CHUNK_SIZE chunks with one vertex array per
+// chunk, so a layer costs a handful of draw calls instead of one per tile.
+// A chunk's vertices are only rebuilt after one of its tiles changes.
+class TileMapRenderer : public sf::Drawable, public sf::Transformable {
+ public:
+  static const unsigned int CHUNK_SIZE = 16;
+
+  bool load(const tmx::Map& map, std::shared_ptr<const sf::Texture> texture);
+
+  std::size_t getLayerCount() const { return layers.size(); }
+  sf::Vector2u getTileCount() const { return tileCount; }
+
+  std::uint32_t getTile(std::size_t layer, unsigned int x, unsigned int y) const;
+  void setTile(std::size_t layer, unsigned int x, unsigned int y, std::uint32_t tileId);
+
+ private:
+  struct Chunk {
+    sf::VertexArray vertices;
+    bool dirty = true;
+  };
+
+  struct Layer {
+    std::vector<std::uint32_t> tiles;
+    std::vector<Chunk> chunks;
+  };
+
+  void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+  void rebuildChunk(const Layer& layer, std::size_t chunkIndex, Chunk& chunk) const;
+
+  std::shared_ptr<const sf::Texture> texture;
+  sf::Vector2u tileCount;
+  sf::Vector2u tileSize;
+  sf::Vector2u chunkCount;
+  std::uint32_t firstGid = 1;
+  // Chunks are rebuilt lazily from draw(), which is const.
+  mutable std::vector<Layer> layers;
+};
+
+#endif // TILE_MAP_RENDERER_H
@@ -0,0 +1,49 @@
+/*********************************************************************
+Matt Marchant 2016 - 2023
+http://trederia.blogspot.com
+
+tmxlite - Zlib license.
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+you must not claim that you wrote the original software.
+If you use this software in a product, an acknowledgment
+in the product documentation would be appreciated but
+is not required.
+
+2. Altered source versions must be plainly marked as such,
+and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+source distribution.
+*********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace tmx
+{
+    namespace detail
+    {
+        //the ways base64_decode() can decode whole blocks. It uses the
+        //fastest the CPU supports; these let each be checked against the others
+        enum class Base64Path
+        {
+            Scalar, SSSE3, AVX2
+        };
+
+        //true if this build and CPU can run the given path
+        bool base64_hasPath(Base64Path);
+
+        //base64_decode() held to one path. A path the CPU can't run decodes as Scalar
+        std::size_t base64_decodeWith(Base64Path, const char* source, std::size_t sourceSize, unsigned char* dest, std::size_t destSize, std::size_t* sourceUsed = nullptr);
+    }
+}
@@ -0,0 +1,317 @@
+/*********************************************************************
+Matt Marchant 2016 - 2023
+http://trederia.blogspot.com
+
+tmxlite - Zlib license.
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+you must not claim that you wrote the original software.
+If you use this software in a product, an acknowledgment
+in the product documentation would be appreciated but
+is not required.
+
+2. Altered source versions must be plainly marked as such,
+and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+source distribution.
+*********************************************************************/
+
+#pragma once
+
+#include <tmxlite/Map.hpp>
+#include <tmxlite/ObjectGroup.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tmx
+{
+    namespace detail
+    {
+        /*!
+        \brief Reads and writes the binary map cache behind Map::saveCache()
+        and Map::loadCache().
+
+        A cache file is a Header followed by a series of sections, each a
+        flat array of one of the record types below, starting on an 8 byte
+        boundary. The header gives the offset and length of each section.
+        Records refer to each other by index: a Range picks out a run of
+        records in another section, a StringRef a run of characters in the
+        string section. Loading maps the file into memory and reads the
+        records in place; the only copies made are into the Map's own
+        containers.
+
+        Tile layers store each tile as its raw 32 bit GID, flip flags
+        included. Object groups belonging to tileset tiles are kept in the
+        layer section with the map's layers, but are only referred to by
+        their tiles.
+
+        Records are written in the byte order of the machine writing them.
+        The magic number doubles as a byte order mark, so another machine
+        sees a mismatch and falls back to the TMX file. FormatVersion must
+        be bumped whenever a record changes.
+        */
+        class MapCache final
+        {
+        public:
+            //hash of the contents of the given files, in order. 0 if any can't be read.
+            static std::uint64_t hashFiles(const std::vector<std::string>& paths);
+
+            static bool save(const Map& map, const std::string& path);
+            static bool load(Map& map, const std::string& path, const std::string& mapPath);
+
+        private:
+            static constexpr std::uint32_t Magic = 0x42584d54; //"TMXB" as a little endian word
+            static constexpr std::uint32_t FormatVersion = 1;
+            static constexpr std::uint32_t NoIndex = 0xffffffff;
+
+            struct StringRef final
+            {
+                std::uint32_t offset = 0;
+                std::uint32_t length = 0;
+            };
+
+            struct Range final
+            {
+                std::uint32_t first = 0;
+                std::uint32_t count = 0;
+            };
+
+            enum Section
+            {
+                Strings, //char
+                SourceFiles, //StringRef
+                Properties, //PropertyRecord
+                Points, //float x, y pairs
+                Objects, //ObjectRecord
+                TileIDs, //std::uint32_t GID
+                Chunks, //ChunkRecord
+                Layers, //LayerRecord
+                Tilesets, //TilesetRecord
+                TilesetTiles, //TilesetTileRecord
+                Frames, //FrameRecord
+                Terrains, //TerrainRecord
+                TileIndices, //std::uint32_t
+                SectionCount
+            };
+
+            struct SectionRecord final
+            {
+                std::uint64_t offset = 0;
+                std::uint64_t size = 0; //bytes
+            };
+
+            struct Header final
+            {
+                std::uint32_t magic = Magic;
+                std::uint32_t version = FormatVersion;
+                std::uint64_t sourceHash = 0;
+                SectionRecord sections[SectionCount];
+
+                std::uint32_t mapVersion[2] = {};
+                StringRef className;
+                std::uint32_t orientation = 0;
+                std::uint32_t renderOrder = 0;
+                std::uint32_t staggerAxis = 0;
+                std::uint32_t staggerIndex = 0;
+                std::uint32_t infinite = 0;
+                std::uint32_t tileCount[2] = {};
+                std::uint32_t tileSize[2] = {};
+                float hexSideLength = 0.f;
+                float parallaxOrigin[2] = {};
+                std::uint8_t backgroundColour[4] = {};
+                StringRef workingDirectory;
+                Range properties;
+                Range layers;
+                Range tilesets;
+                std::uint32_t reserved = 0; //keeps the size a multiple of 8
+            };
+
+            struct PropertyRecord final
+            {
+                StringRef name;
+                StringRef stringValue;
+                std::uint32_t type = 0;
+                std::uint32_t value = 0; //bool, float or int depending on type
+                std::uint8_t colour[4] = {};
+            };
+
+            struct ObjectRecord final
+            {
+                std::uint32_t uid = 0;
+                StringRef name;
+                StringRef className;
+                float position[2] = {};
+                float aabb[4] = {};
+                float rotation = 0.f;
+                std::uint32_t tileID = 0;
+                std::uint32_t flipFlags = 0;
+                std::uint32_t visible = 0;
+                std::uint32_t shape = 0;
+                Range points;
+                Range properties;
+                StringRef tilesetName;
+
+                StringRef fontFamily;
+                StringRef textContent;
+                std::uint32_t pixelSize = 0;
+                std::uint32_t textFlags = 0; //TextFlag bits
+                std::uint32_t hAlign = 0;
+                std::uint32_t vAlign = 0;
+                std::uint8_t textColour[4] = {};
+            };
+
+            enum TextFlag
+            {
+                Wrap = 0x1, Bold = 0x2, Italic = 0x4, Underline = 0x8, Strikethrough = 0x10, Kerning = 0x20
+            };
+
+            struct ChunkRecord final
+            {
+                std::int32_t position[2] = {};
+                std::int32_t size[2] = {};
+                Range tiles;
+            };
+
+            //one record for every layer type, with the fields of the others left empty
+            struct LayerRecord final
+            {
+                std::uint32_t type = 0;
+                StringRef name;
+                StringRef className;
+                float opacity = 1.f;
+                std::uint32_t visible = 0;
+                std::int32_t offset[2] = {};
+                float parallaxFactor[2] = {};
+                std::uint8_t tintColour[4] = {};
+                std::uint32_t size[2] = {};
+                Range properties;
+
+                //tile layers
+                std::uint32_t expectedTiles = 0;
+                Range tiles;
+                Range chunks;
+
+                //object groups
+                std::uint8_t colour[4] = {};
+                std::uint32_t drawOrder = 0;
+                Range objects;
+                Range groupProperties;
+
+                //image layers and groups
+                StringRef workingDirectory;
+                StringRef imagePath;
+                std::uint8_t transparencyColour[4] = {};
+                std::uint32_t hasTransparency = 0;
+                std::uint32_t imageSize[2] = {};
+                std::uint32_t repeat[2] = {};
+                std::uint32_t tileCount[2] = {};
+                Range layers;
+            };
+
+            struct TilesetRecord final
+            {
+                StringRef workingDirectory;
+                StringRef source;
+                StringRef name;
+                StringRef className;
+                StringRef imagePath;
+                std::uint32_t firstGID = 0;
+                std::uint32_t tileSize[2] = {};
+                std::uint32_t spacing = 0;
+                std::uint32_t margin = 0;
+                std::uint32_t tileCount = 0;
+                std::uint32_t columnCount = 0;
+                std::uint32_t objectAlignment = 0;
+                std::uint32_t tileOffset[2] = {};
+                std::uint32_t imageSize[2] = {};
+                std::uint8_t transparencyColour[4] = {};
+                std::uint32_t hasTransparency = 0;
+                Range properties;
+                Range terrains;
+                Range tileIndices;
+                Range tiles;
+            };
+
+            struct TilesetTileRecord final
+            {
+                std::uint32_t id = 0;
+                std::int32_t terrainIndices[4] = {};
+                std::uint32_t probability = 0;
+                Range frames;
+                Range properties;
+                std::uint32_t objectGroup = NoIndex; //index into Layers
+                StringRef imagePath;
+                StringRef className;
+                std::uint32_t imageSize[2] = {};
+                std::uint32_t imagePosition[2] = {};
+            };
+
+            struct FrameRecord final
+            {
+                std::uint32_t tileID = 0;
+                std::uint32_t duration = 0;
+            };
+
+            struct TerrainRecord final
+            {
+                StringRef name;
+                std::uint32_t tileID = 0;
+                Range properties;
+            };
+
+            //writing, each returns where its records went
+            StringRef addString(const std::string&);
+            Range addProperties(const std::vector<Property>&);
+            Range addObjects(const std::vector<Object>&);
+            Range addLayers(const std::vector<Layer::Ptr>&);
+            std::uint32_t addObjectGroup(const ObjectGroup&);
+            void fillLayer(std::uint32_t index, const Layer&);
+            Range addTilesets(const std::vector<Tileset>&);
+            bool writeFile(const std::string& path, Header& header) const;
+
+            std::vector<char> m_strings;
+            std::unordered_map<std::string, StringRef> m_stringIndex;
+            std::vector<StringRef> m_sourceFiles;
+            std::vector<PropertyRecord> m_properties;
+            std::vector<float> m_points;
+            std::vector<ObjectRecord> m_objects;
+            std::vector<std::uint32_t> m_tileIDs;
+            std::vector<ChunkRecord> m_chunks;
+            std::vector<LayerRecord> m_layers;
+            std::vector<TilesetRecord> m_tilesets;
+            std::vector<TilesetTileRecord> m_tilesetTiles;
+            std::vector<FrameRecord> m_frames;
+            std::vector<TerrainRecord> m_terrains;
+            std::vector<std::uint32_t> m_tileIndices;
+
+            //reading, from a file mapped at m_data. Anything out of bounds
+            //clears m_valid and reads as empty.
+            template <typename T>
+            const T* records(Section, Range);
+            std::string readString(StringRef);
+            std::vector<Property> readProperties(Range);
+            std::vector<Object> readObjects(Range);
+            std::vector<Layer::Ptr> readLayers(Range, std::uint32_t depth);
+            Layer::Ptr readLayer(const LayerRecord&, std::uint32_t depth);
+            void readObjectGroup(const LayerRecord&, ObjectGroup&);
+            std::vector<Tileset> readTilesets(Range);
+
+            const unsigned char* m_data = nullptr;
+            std::size_t m_size = 0;
+            const Header* m_header = nullptr;
+            bool m_valid = true;
+        };
+    }
+}
@@ -0,0 +1,84 @@
+/*********************************************************************
+Matt Marchant 2016 - 2023
+http://trederia.blogspot.com
+
+tmxlite - Zlib license.
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+you must not claim that you wrote the original software.
+If you use this software in a product, an acknowledgment
+in the product documentation would be appreciated but
+is not required.
+
+2. Altered source versions must be plainly marked as such,
+and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+source distribution.
+*********************************************************************/
+
+#pragma once
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tmx
+{
+    namespace detail
+    {
+        /*!
+        \brief Owns a set of threads and joins them all when it goes out of
+        scope. If starting a thread throws, the ones already running are
+        joined before the exception leaves the scope, rather than being
+        destroyed while joinable and terminating the program.
+        */
+        class ThreadGroup final
+        {
+        public:
+            ThreadGroup() = default;
+            ~ThreadGroup() { join(); }
+
+            ThreadGroup(const ThreadGroup&) = delete;
+            ThreadGroup& operator = (const ThreadGroup&) = delete;
+
+            template <typename F>
+            void start(F&& f) { m_threads.emplace_back(std::forward<F>(f)); }
+
+            void join()
+            {
+                for (auto& thread : m_threads)
+                {
+                    if (thread.joinable())
+                    {
+                        thread.join();
+                    }
+                }
+                m_threads.clear();
+            }
+
+        private:
+            std::vector<std::thread> m_threads;
+        };
+
+        /*!
+        \brief True on a thread which is already one of several loading a map
+        in parallel, see Map::setLoadThreadCount(). Work on such a thread
+        should not start threads of its own, as the pool already has one per
+        core to spare.
+        */
+        inline bool& inLoadPool()
+        {
+            thread_local bool inPool = false;
+            return inPool;
+        }
+    }
+}
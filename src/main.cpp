@@ -22,33 +22,8 @@ int main()
 
   while (window.isOpen())
   {
-
-    sf::Event event;
-
-    game.handleEvents();
-    game.update(0.0f);
-    game.render();
-
-    sf::Time time = clock.restart();
-    float dt = time.asSeconds();
-
-    while (window.pollEvent(event))
-    {
-
-      if (event.type == sf::Event::Closed)
-        window.close();
-
-      if (event.type == sf::Event::KeyPressed)
-        game.keyPressed(event);
-    }
-
-    game.update(dt);
-
-    window.clear(sf::Color::White);
-
-    game.render();
-    window.display();
+    game.frame(clock.restart());
   }
 
   return 0;
-}
\ No newline at end of file
+}